@@ -0,0 +1,754 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// offline benchmark of the MI record parser and value decoding, no GDB or GUI
+//
+// usage: tug_bench [-i iterations] [transcript...]
+// transcripts are tug --record files or newline separated MI output lines,
+// they get run after the generated corpus
+
+#include "common.h"
+#include "gdb.h"
+
+#include <algorithm>
+#include <new>
+#include <stdarg.h>
+
+Program prog;
+GDB gdb;
+
+//
+// stand-ins for the main.cpp functions that gdb.cpp and varobj.cpp call
+//
+
+String _StringPrintf(int /* vargs_check */, const char *fmt, ...)
+{
+    String result;
+    va_list args;
+    va_start(args, fmt);
+    int len_minus_nt = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    if (len_minus_nt > 0)
+    {
+        result.resize(len_minus_nt + 1, '\0');
+        va_start(args, fmt);
+        vsnprintf(&result[0], result.size(), fmt, args);
+        va_end(args);
+        result.pop_back(); // remove NT
+    }
+
+    return result;
+}
+
+const char *GetErrorString(int _errno)
+{
+    return strerror(_errno);
+}
+
+void WriteToConsoleBuffer(const char *, size_t)
+{
+    // console output isn't part of the measurement
+}
+
+void WakeUIThread()
+{
+    // no UI thread, the pipeline stage polls the ring
+}
+
+bool VerifyFileExecutable(const char *)
+{
+    return false;
+}
+
+bool InvokeShellCommand(String, String &)
+{
+    return false;
+}
+
+//
+// allocation counting, covers every thread
+//
+
+static std::atomic<size_t> num_allocs;
+
+void *operator new(size_t size)
+{
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *result = malloc(size ? size : 1);
+    if (result == NULL)
+        throw std::bad_alloc();
+    return result;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//
+// corpus
+//
+
+struct BenchCorpus
+{
+    String name;
+    String text;            // newline terminated MI lines
+    size_t num_lines;
+};
+
+struct BenchResult
+{
+    size_t bytes;
+    size_t records;
+    size_t allocs;
+    uint64_t elapsed_ns;
+    Vector<uint64_t> latency_ns;    // per record, empty when not measured
+};
+
+// deterministic so runs can be compared against each other
+static uint32_t bench_seed = 12345;
+static uint32_t NextRandom()
+{
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return bench_seed >> 8;
+}
+
+static void AppendLine(BenchCorpus &corpus, const String &line)
+{
+    corpus.text += line;
+    corpus.text += '\n';
+    corpus.num_lines++;
+}
+
+static String MakeFrame(size_t level)
+{
+    uint32_t file = NextRandom() % 64;
+    return StringPrintf("frame={level=\"%zu\",addr=\"0x%016llx\",func=\"function_%u\","
+                        "file=\"src/module_%u.c\",fullname=\"/home/user/project/src/module_%u.c\","
+                        "line=\"%u\",arch=\"i386:x86-64\"}",
+                        level, 0x555555554000ull + NextRandom(), NextRandom() % 4096,
+                        file, file, NextRandom() % 5000 + 1);
+}
+
+static BenchCorpus MakeStackCorpus()
+{
+    // deep recursion, -stack-list-frames
+    BenchCorpus result = { "stack" };
+    for (size_t r = 0; r < 20; r++)
+    {
+        String line = StringPrintf("%zu^done,stack=[", r + 1);
+        for (size_t i = 0; i < 2000; i++)
+        {
+            if (i > 0) line += ',';
+            line += MakeFrame(i);
+        }
+        line += ']';
+        AppendLine(result, line);
+    }
+    return result;
+}
+
+static BenchCorpus MakeThreadCorpus()
+{
+    // thread pool startup and a -thread-info over all of them
+    BenchCorpus result = { "threads" };
+    const size_t num_threads = 4000;
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        AppendLine(result, StringPrintf("~\"[New Thread 0x7ffff%06x (LWP %zu)]\\n\"",
+                                        NextRandom() % 0xffffff, 10000 + i));
+        AppendLine(result, StringPrintf("=thread-created,id=\"%zu\",group-id=\"i1\"", i + 1));
+    }
+
+    String line = "1^done,threads=[";
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        if (i > 0) line += ',';
+        line += StringPrintf("{id=\"%zu\",target-id=\"Thread 0x7ffff%06x (LWP %zu)\","
+                             "name=\"worker-%zu\",",
+                             i + 1, NextRandom() % 0xffffff, 10000 + i, i);
+        line += MakeFrame(0);
+        line += ",state=\"stopped\",core=\"3\"}";
+    }
+    line += "],current-thread-id=\"1\"";
+    AppendLine(result, line);
+
+    AppendLine(result, "*stopped,reason=\"breakpoint-hit\",disp=\"keep\",bkptno=\"1\"," +
+               MakeFrame(0) + ",thread-id=\"1\",stopped-threads=\"all\",core=\"3\"");
+    return result;
+}
+
+static BenchCorpus MakeMemoryCorpus()
+{
+    // -data-read-memory-bytes of a large buffer
+    BenchCorpus result = { "memory" };
+    static const char HEX[] = "0123456789abcdef";
+    for (size_t r = 0; r < 4; r++)
+    {
+        const size_t num_bytes = 2 * 1024 * 1024;
+        String line = StringPrintf("%zu^done,memory=[{begin=\"0x7ffff7a00000\","
+                                   "offset=\"0x0000000000000000\",end=\"0x7ffff7c00000\",contents=\"",
+                                   r + 1);
+        line.reserve(line.size() + num_bytes * 2 + 8);
+        for (size_t i = 0; i < num_bytes; i++)
+        {
+            uint32_t byte = (i & 64) ? 0 : NextRandom() & 0xff;
+            line += HEX[byte >> 4];
+            line += HEX[byte & 0xf];
+        }
+        line += "\"}]";
+        AppendLine(result, line);
+    }
+    return result;
+}
+
+static BenchCorpus MakeLocalsCorpus()
+{
+    // -stack-list-variables --all-values with aggregates
+    BenchCorpus result = { "locals" };
+    for (size_t r = 0; r < 2000; r++)
+    {
+        String line = StringPrintf("%zu^done,variables=[", r + 1);
+        line += StringPrintf("{name=\"zeroed\",value=\"{0 <repeats %u times>}\"},",
+                             64 + NextRandom() % 512);
+        line += StringPrintf("{name=\"item\",value=\"{id = %u, name = 0x555555556004 \\\"item \\\\\\\"%u\\\\\\\"\\\", "
+                             "pos = {x = 1.5, y = -2, z = 0}, data = {1, 2, 3, 4, 5, 6, 7, 8}, "
+                             "next = 0x0, flags = {enabled = true, visible = false}}\"},",
+                             NextRandom() % 100, (uint32_t)r);
+        line += StringPrintf("{name=\"table\",value=\"{{key = 0, value = 0x0} <repeats %u times>, "
+                             "{key = %u, value = 0x5555555592a0}, {key = 0, value = 0x0} <repeats 15 times>}\"},",
+                             16 + NextRandom() % 64, NextRandom() % 1000);
+        line += "{name=\"matrix\",value=\"{";
+        for (size_t row = 0; row < 16; row++)
+        {
+            if (row > 0) line += ", ";
+            line += StringPrintf("{%u, %u, 0 <repeats 14 times>}", NextRandom() % 10, NextRandom() % 10);
+        }
+        line += "}\"},";
+        line += StringPrintf("{name=\"count\",value=\"%u\"}]", NextRandom() % 100);
+        AppendLine(result, line);
+    }
+    return result;
+}
+
+static BenchCorpus MakeDisassemblyCorpus()
+{
+    // -data-disassemble with source lines
+    BenchCorpus result = { "disassembly" };
+    static const char *INSTRUCTIONS[][2] =
+    {
+        { "55", "push   %rbp" },
+        { "48 89 e5", "mov    %rsp,%rbp" },
+        { "48 83 ec 20", "sub    $0x20,%rsp" },
+        { "89 7d ec", "mov    %edi,-0x14(%rbp)" },
+        { "e8 00 00 00 00", "call   0x555555555030 <puts@plt>" },
+        { "c9", "leave" },
+        { "c3", "ret" },
+    };
+
+    for (size_t r = 0; r < 200; r++)
+    {
+        String line = StringPrintf("%zu^done,asm_insns=[", r + 1);
+        unsigned long long addr = 0x555555555139ull;
+        for (size_t src = 0; src < 50; src++)
+        {
+            if (src > 0) line += ',';
+            line += StringPrintf("src_and_asm_line={line=\"%zu\",file=\"main.c\","
+                                 "fullname=\"/home/user/project/src/main.c\",line_asm_insn=[", src + 10);
+            for (size_t i = 0; i < 4; i++)
+            {
+                size_t pick = NextRandom() % ArrayCount(INSTRUCTIONS);
+                if (i > 0) line += ',';
+                line += StringPrintf("{address=\"0x%016llx\",func-name=\"main\",offset=\"%llu\","
+                                     "opcodes=\"%s\",inst=\"%s\"}",
+                                     addr, addr - 0x555555555139ull,
+                                     INSTRUCTIONS[pick][0], INSTRUCTIONS[pick][1]);
+                addr += 4;
+            }
+            line += "]}";
+        }
+        line += ']';
+        AppendLine(result, line);
+    }
+    return result;
+}
+
+static BenchCorpus MakeBreakpointCorpus()
+{
+    // startup, shared libraries and a batch of breakpoints
+    BenchCorpus result = { "breakpoints" };
+    for (size_t i = 0; i < 1000; i++)
+    {
+        AppendLine(result, StringPrintf("=library-loaded,id=\"/usr/lib/x86_64-linux-gnu/lib%zu.so.6\","
+                                        "target-name=\"/usr/lib/x86_64-linux-gnu/lib%zu.so.6\","
+                                        "host-name=\"/usr/lib/x86_64-linux-gnu/lib%zu.so.6\","
+                                        "symbols-loaded=\"0\",thread-group=\"i1\","
+                                        "ranges=[{from=\"0x00007ffff7dc%04x\",to=\"0x00007ffff7f5%04x\"}]",
+                                        i, i, i, NextRandom() & 0xffff, NextRandom() & 0xffff));
+    }
+
+    for (size_t i = 0; i < 2000; i++)
+    {
+        uint32_t file = NextRandom() % 64;
+        uint32_t lineno = NextRandom() % 5000 + 1;
+        AppendLine(result, StringPrintf("=breakpoint-created,bkpt={number=\"%zu\",type=\"breakpoint\","
+                                        "disp=\"keep\",enabled=\"y\",addr=\"0x%016llx\",func=\"function_%u\","
+                                        "file=\"src/module_%u.c\",fullname=\"/home/user/project/src/module_%u.c\","
+                                        "line=\"%u\",thread-groups=[\"i1\"],times=\"0\","
+                                        "original-location=\"module_%u.c:%u\"}",
+                                        i + 1, 0x555555554000ull + NextRandom(), NextRandom() % 4096,
+                                        file, file, lineno, file, lineno));
+        AppendLine(result, "(gdb) ");
+    }
+    return result;
+}
+
+static bool LoadTranscript(const char *filename, BenchCorpus &out)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "can't open %s: %s\n", filename, GetErrorString(errno));
+        return false;
+    }
+
+    out = {};
+    const char *slash = strrchr(filename, '/');
+    out.name = (slash) ? slash + 1 : filename;
+
+    char buf[64 * 1024];
+    size_t num_read = 0;
+    while (0 != (num_read = fread(buf, 1, sizeof(buf), f)))
+        out.text.append(buf, num_read);
+    fclose(f);
+
+    // --record transcripts get their GDB output stitched back together
+    Vector<TranscriptEntry> entries;
+    if (GDB_ParseTranscript(out.text, entries))
+    {
+        out.text.clear();
+        for (const TranscriptEntry &entry : entries)
+            if (entry.direction == TRANSCRIPT_FROM_GDB)
+                out.text += entry.data;
+    }
+
+    // GDB_ParseLine wants every line newline terminated
+    if (out.text.size() > 0 && out.text.back() != '\n')
+        out.text += '\n';
+
+    out.num_lines = std::count(out.text.begin(), out.text.end(), '\n');
+    return true;
+}
+
+//
+// stages
+//
+
+template <typename Fn>
+static void ForEachLine(const BenchCorpus &corpus, Fn fn)
+{
+    const char *iter = corpus.text.data();
+    const char *end = iter + corpus.text.size();
+    while (iter < end)
+    {
+        const char *eol = (const char *)memchr(iter, '\n', end - iter);
+        size_t linesize = eol + 1 - iter;
+        fn(iter, linesize);
+        iter += linesize;
+    }
+}
+
+static BenchResult BenchParse(const BenchCorpus &corpus, int iterations)
+{
+    // same as the reader thread, one context and a pooled line
+    BenchResult result = {};
+    ParseRecordContext ctx = {};
+    RecordLine line = {};
+    ForEachLine(corpus, [&](const char *text, size_t size) { GDB_ParseLine(text, size, ctx, line); });
+
+    result.latency_ns.reserve(corpus.num_lines * iterations);
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        ForEachLine(corpus, [&](const char *text, size_t size)
+        {
+            uint64_t t = GetNanoseconds();
+            GDB_ParseLine(text, size, ctx, line);
+            result.latency_ns.push_back(GetNanoseconds() - t);
+            result.bytes += size;
+        });
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    result.records = corpus.num_lines * iterations;
+    return result;
+}
+
+static void ParseCorpus(const BenchCorpus &corpus, Vector<Record> &out)
+{
+    ParseRecordContext ctx = {};
+    RecordLine line = {};
+    ForEachLine(corpus, [&](const char *text, size_t size)
+    {
+        GDB_ParseLine(text, size, ctx, line);
+        if (line.is_record)
+            out.push_back(line.rec);
+    });
+}
+
+static void RecurseExtract(const Record &rec, const RecordAtom &parent, size_t &checksum)
+{
+    // fields the UI reads out of frames, threads, breakpoints, instructions
+    static constexpr AtomPath FIELDS[] =
+    {
+        "addr", "address", "func", "file", "fullname", "name", "value",
+        "target-id", "inst", "opcodes", "contents", "frame.func", "frame.fullname",
+    };
+    static constexpr AtomPath INT_FIELDS[] =
+    {
+        "line", "level", "id", "number", "frame.line",
+    };
+
+    for (const AtomPath &path : FIELDS)
+        checksum += GDB_ExtractView(path, parent, rec).size;
+    for (const AtomPath &path : INT_FIELDS)
+        checksum += GDB_ExtractInt(path, parent, rec);
+
+    for (const RecordAtom &child : GDB_IterChild(rec, &parent))
+        if (child.type == Atom_Array || child.type == Atom_Struct)
+            RecurseExtract(rec, child, checksum);
+}
+
+static BenchResult BenchExtract(const BenchCorpus &corpus, int iterations, size_t &checksum)
+{
+    BenchResult result = {};
+    Vector<Record> recs;
+    ParseCorpus(corpus, recs);
+
+    result.latency_ns.reserve(recs.size() * iterations);
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const Record &rec : recs)
+        {
+            uint64_t t = GetNanoseconds();
+            RecurseExtract(rec, rec.atoms[0], checksum);
+            result.latency_ns.push_back(GetNanoseconds() - t);
+            result.bytes += rec.buf.size();
+        }
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    result.records = recs.size() * iterations;
+    return result;
+}
+
+static BenchResult BenchEvaluate(const BenchCorpus &corpus, int iterations, size_t &checksum)
+{
+    // aggregate values go through CreateVarObj and get compared against
+    // the previous stop, same as the locals window
+    BenchResult result = {};
+    Vector<Record> recs;
+    ParseCorpus(corpus, recs);
+
+    Vector<VarObj> values;
+    for (const Record &rec : recs)
+    {
+        static constexpr AtomPath VARIABLES = "variables";
+        static constexpr AtomPath NAME = "name";
+        static constexpr AtomPath VALUE = "value";
+        const RecordAtom *vars = GDB_ExtractAtom(VARIABLES, rec);
+        for (const RecordAtom &var : GDB_IterChild(rec, vars))
+        {
+            VarObj add = {};
+            add.name = GDB_ExtractValue(NAME, var, rec);
+            add.value = GDB_ExtractValue(VALUE, var, rec);
+            if (add.value.size() > 0 && add.value[0] == '{')
+                values.push_back(add);
+        }
+    }
+
+    if (values.size() == 0)
+        return result;
+
+    Vector<VarObj> last(values.size());
+    for (size_t v = 0; v < values.size(); v++)
+        last[v] = CreateVarObj(values[v].name, values[v].value);
+
+    result.latency_ns.reserve(values.size() * iterations);
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (size_t v = 0; v < values.size(); v++)
+        {
+            // compare against a neighbor so some elements differ
+            const VarObj &prev = last[ (v + 1) % last.size() ];
+            uint64_t t = GetNanoseconds();
+            VarObj incoming = CreateVarObj(values[v].name, values[v].value);
+            if (incoming.name == prev.name)
+                CheckIfChanged(incoming, prev);
+            result.latency_ns.push_back(GetNanoseconds() - t);
+
+            checksum += incoming.expr.atoms.size();
+            result.bytes += values[v].value.size();
+        }
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    result.records = values.size() * iterations;
+    return result;
+}
+
+static std::atomic<bool> pipeline_reader_done;
+
+static void *PipelineReader(void *)
+{
+    extern void *GDB_ReadInterpreterBlocks(void *);
+    GDB_ReadInterpreterBlocks(NULL);
+    pipeline_reader_done.store(true);
+    return NULL;
+}
+
+static void *PipelineWriter(void *arg)
+{
+    const BenchCorpus &corpus = *(const BenchCorpus *)arg;
+    const char *iter = corpus.text.data();
+    size_t remaining = corpus.text.size();
+    while (remaining > 0)
+    {
+        ssize_t written = write(gdb.fd_in_write, iter, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            fprintf(stderr, "pipe write %s\n", GetErrorString(errno));
+            break;
+        }
+
+        iter += written;
+        remaining -= written;
+    }
+
+    close(gdb.fd_in_write);
+    return NULL;
+}
+
+static BenchResult BenchPipeline(const BenchCorpus &corpus, int iterations)
+{
+    // GDB pipe -> reader thread -> ring -> GDB_GrabBlockData, the whole
+    // path a line takes before the UI dispatches it
+    BenchResult result = {};
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        int fd[2];
+        if (0 != pipe(fd))
+        {
+            fprintf(stderr, "pipe %s\n", GetErrorString(errno));
+            break;
+        }
+
+        gdb.fd_in_read = fd[0];
+        gdb.fd_in_write = fd[1];
+        pipeline_reader_done.store(false);
+
+        pthread_t reader, writer;
+        pthread_create(&reader, NULL, PipelineReader, NULL);
+        pthread_create(&writer, NULL, PipelineWriter, (void *)&corpus);
+
+        while (!pipeline_reader_done.load() || RingCount(gdb.from_gdb) > 0)
+        {
+            RingWaitForData(gdb.from_gdb, 10);
+            GDB_GrabBlockData();
+            prog.num_recs = 0;
+        }
+
+        pthread_join(writer, NULL);
+        pthread_join(reader, NULL);
+        close(gdb.fd_in_read);
+        result.bytes += corpus.text.size();
+        result.records += corpus.num_lines;
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    return result;
+}
+
+static BenchResult BenchConsole(const BenchCorpus &corpus, int iterations)
+{
+    // every line written to the console scrollback as WriteToConsoleBuffer would
+    BenchResult result = {};
+    ConsoleLog log = {};
+    log.max_resident_chunks = 64;
+    String decoded;
+
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        ForEachLine(corpus, [&](const char *text, size_t size)
+        {
+            bool is_console_record = (size > 4 && text[0] == PREFIX_CONSOLE_LOG && text[1] == '"');
+            if (is_console_record)
+                ConsoleDecode(text + 2, size - 4, true, decoded);
+            else
+                ConsoleDecode(text, size, false, decoded);
+
+            ConsoleAppend(log, decoded.data(), decoded.size());
+            result.bytes += size;
+        });
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    result.records = corpus.num_lines * iterations;
+    return result;
+}
+
+static BenchResult BenchSource(const BenchCorpus &corpus, int iterations, size_t &checksum)
+{
+    // corpus text as a source file, index every line and view each one
+    BenchResult result = {};
+    Vector<String> texts(iterations, corpus.text);
+
+    size_t start_allocs = num_allocs.load();
+    uint64_t start = GetNanoseconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        File file = {};
+        SetFileText(file, std::move(texts[i]));
+        for (size_t line_idx = 0; line_idx < GetLineCount(file); line_idx++)
+            checksum += GetLine(file, line_idx).size;
+
+        result.bytes += GetFileSize(file);
+        result.records += GetLineCount(file);
+    }
+
+    result.elapsed_ns = GetNanoseconds() - start;
+    result.allocs = num_allocs.load() - start_allocs;
+    return result;
+}
+
+//
+// report
+//
+
+static void PrintResult(const char *corpus, const char *stage, BenchResult &result)
+{
+    if (result.records == 0)
+        return;
+
+    double seconds = result.elapsed_ns / 1e9;
+    char p50[32] = "-";
+    char p99[32] = "-";
+    if (result.latency_ns.size() > 0)
+    {
+        Vector<uint64_t> &lat = result.latency_ns;
+        std::sort(lat.begin(), lat.end());
+        tsnprintf(p50, "%.2f", lat[ lat.size() / 2 ] / 1e3);
+        tsnprintf(p99, "%.2f", lat[ (lat.size() * 99) / 100 ] / 1e3);
+    }
+
+    printf("%-14s %-10s %10.1f %12.0f %11.2f %10s %10s\n",
+           corpus, stage,
+           (result.bytes / (1024.0 * 1024.0)) / seconds,
+           result.records / seconds,
+           (double)result.allocs / result.records,
+           p50, p99);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 3;
+    Vector<BenchCorpus> corpora;
+    corpora.push_back( MakeStackCorpus() );
+    corpora.push_back( MakeThreadCorpus() );
+    corpora.push_back( MakeMemoryCorpus() );
+    corpora.push_back( MakeLocalsCorpus() );
+    corpora.push_back( MakeDisassemblyCorpus() );
+    corpora.push_back( MakeBreakpointCorpus() );
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strcmp(argv[i], "-i") && i + 1 < argc)
+        {
+            iterations = atoi(argv[++i]);
+            if (iterations < 1)
+                iterations = 1;
+        }
+        else
+        {
+            BenchCorpus add = {};
+            if (!LoadTranscript(argv[i], add))
+                return 1;
+            corpora.push_back(add);
+        }
+    }
+
+    if (!RingInit(gdb.from_gdb, 4096) || !RingInit(gdb.free_lines, 4096) ||
+        0 != pthread_mutex_init(&gdb.pending_lock, NULL))
+    {
+        fprintf(stderr, "bench init failed\n");
+        return 1;
+    }
+    for (PendingCommand &iter : gdb.pending)
+        pthread_cond_init(&iter.cond, NULL);
+    gdb.initialized_pending = true;
+
+    printf("%-14s %-10s %10s %12s %11s %10s %10s\n",
+           "corpus", "stage", "MB/s", "records/s", "allocs/rec", "p50 us", "p99 us");
+
+    size_t checksum = 0;
+    for (const BenchCorpus &corpus : corpora)
+    {
+        const char *name = corpus.name.c_str();
+        BenchResult parse = BenchParse(corpus, iterations);
+        PrintResult(name, "parse", parse);
+
+        BenchResult extract = BenchExtract(corpus, iterations, checksum);
+        PrintResult(name, "extract", extract);
+
+        BenchResult evaluate = BenchEvaluate(corpus, iterations, checksum);
+        PrintResult(name, "evaluate", evaluate);
+
+        BenchResult pipeline = BenchPipeline(corpus, iterations);
+        PrintResult(name, "pipeline", pipeline);
+
+        BenchResult console = BenchConsole(corpus, iterations);
+        PrintResult(name, "console", console);
+
+        BenchResult source = BenchSource(corpus, iterations, checksum);
+        PrintResult(name, "source", source);
+    }
+
+    // keep the extract work from getting optimized out
+    printf("checksum %zu\n", checksum);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Copyright (C) 2022 Kyle Sylvestre
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// --bench-stops inferior: large arrays and nested structs, mostly zeroed
+// so GDB prints them with <repeats N times>
+
+#include <string.h>
+
+static volatile int sink;
+
+__attribute__((noinline)) void bench_stop(int iteration)
+{
+    sink = iteration;
+}
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct Particle
+{
+    Vec3 pos;
+    Vec3 vel;
+    int flags;
+    char name[16];
+};
+
+struct World
+{
+    int ids[4096];
+    Particle particles[512];
+    double grid[32][32];
+    const char *title;
+};
+
+static World world;
+
+void Simulate(int iteration)
+{
+    int counts[1024] = {};
+    Particle local_particles[64];
+    memset(local_particles, 0, sizeof(local_particles));
+
+    counts[iteration % 1024] = iteration;
+    world.ids[iteration % 4096] = iteration;
+    bench_stop(iteration);
+
+    Particle &p = world.particles[iteration % 512];
+    p.pos.x += 1.0f;
+    p.vel.y = (float)iteration;
+    local_particles[iteration % 64] = p;
+    world.grid[iteration % 32][(iteration / 32) % 32] += 0.5;
+    bench_stop(iteration);
+
+    sink += counts[iteration % 1024] + local_particles[0].flags;
+}
+
+int main()
+{
+    world.title = "synthetic world";
+    for (int i = 0; i < 1000000; i++)
+        Simulate(i);
+    return 0;
+}
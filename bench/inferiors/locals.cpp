@@ -0,0 +1,61 @@
+// Copyright (C) 2022 Kyle Sylvestre
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// --bench-stops inferior: hundreds of scalar locals in one frame, a few
+// of them change between steps
+
+static volatile int sink;
+
+__attribute__((noinline)) void bench_stop(int iteration)
+{
+    sink = iteration;
+}
+
+#define LOCAL(n) int local_##n = (n) * iteration; 
+#define LOCAL10(n) LOCAL(n##0) LOCAL(n##1) LOCAL(n##2) LOCAL(n##3) LOCAL(n##4)\
+                   LOCAL(n##5) LOCAL(n##6) LOCAL(n##7) LOCAL(n##8) LOCAL(n##9)
+#define USE(n) sink += local_##n;
+#define USE10(n) USE(n##0) USE(n##1) USE(n##2) USE(n##3) USE(n##4)\
+                 USE(n##5) USE(n##6) USE(n##7) USE(n##8) USE(n##9)
+
+void ManyLocals(int iteration)
+{
+    LOCAL10(1) LOCAL10(2) LOCAL10(3) LOCAL10(4) LOCAL10(5)
+    LOCAL10(6) LOCAL10(7) LOCAL10(8) LOCAL10(9) LOCAL10(10)
+    LOCAL10(11) LOCAL10(12) LOCAL10(13) LOCAL10(14) LOCAL10(15)
+    LOCAL10(16) LOCAL10(17) LOCAL10(18) LOCAL10(19) LOCAL10(20)
+    LOCAL10(21) LOCAL10(22) LOCAL10(23) LOCAL10(24) LOCAL10(25)
+    LOCAL10(26) LOCAL10(27) LOCAL10(28) LOCAL10(29) LOCAL10(30)
+
+    bench_stop(iteration);
+    local_10 += 1;
+    local_150 += 2;
+    local_299 += 3;
+    bench_stop(iteration);
+
+    USE10(1) USE10(2) USE10(3) USE10(4) USE10(5)
+    USE10(6) USE10(7) USE10(8) USE10(9) USE10(10)
+    USE10(11) USE10(12) USE10(13) USE10(14) USE10(15)
+    USE10(16) USE10(17) USE10(18) USE10(19) USE10(20)
+    USE10(21) USE10(22) USE10(23) USE10(24) USE10(25)
+    USE10(26) USE10(27) USE10(28) USE10(29) USE10(30)
+}
+
+int main()
+{
+    for (int i = 0; i < 1000000; i++)
+        ManyLocals(i);
+    return 0;
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2022 Kyle Sylvestre
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// --bench-stops inferior: deep call stacks, bench_stop gets hit on every
+// level on the way down so the stack keeps changing size
+
+static volatile int sink;
+
+__attribute__((noinline)) void bench_stop(int depth)
+{
+    sink = depth;
+}
+
+int Recurse(int depth, int max_depth)
+{
+    int local = depth * 2;
+    const char *label = (depth % 2) ? "odd" : "even";
+    bench_stop(depth);
+    if (depth < max_depth)
+        local += Recurse(depth + 1, max_depth);
+
+    sink += local + label[0];
+    return local;
+}
+
+int main()
+{
+    for (int i = 0; i < 1000000; i++)
+        Recurse(0, 2000 + (i % 7) * 100);
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2022 Kyle Sylvestre
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// --bench-stops inferior: hundreds of threads parked on a condition
+// variable while the main thread keeps hitting bench_stop
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static volatile int sink;
+static std::mutex lock;
+static std::condition_variable wake;
+static bool done;
+
+__attribute__((noinline)) void bench_stop(int iteration)
+{
+    sink = iteration;
+}
+
+static void Worker(int id)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!done)
+        wake.wait(guard);
+    sink += id;
+}
+
+int main()
+{
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 256; i++)
+        workers.emplace_back(Worker, i);
+
+    for (int i = 0; i < 1000000; i++)
+    {
+        int local = i * 3;
+        bench_stop(i);
+        sink += local;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+    return 0;
+}
@@ -18,6 +18,8 @@
 // sepples
 #include <string>
 #include <vector>
+#include <functional>
+#include <unordered_map>
 
 // cstd
 #include <sys/wait.h>
@@ -39,6 +41,7 @@
 #include <semaphore.h>
 #include <poll.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #if defined(__APPLE__)
@@ -49,9 +52,13 @@ int sem_timedwait(sem_t *sem, const struct timespec *abs_timeout);
 #include <dirent.h>
 #endif
 
+#include "ring.h"
+
 template <typename T>
 using Vector = std::vector<T>;
 using String = std::basic_string<char, std::char_traits<char>>;
+template <typename K, typename V>
+using HashMap = std::unordered_map<K, V>;
 
 #define VARGS_CHECK(fmt, ...) (0 && snprintf(NULL, 0, fmt, __VA_ARGS__))
 #define StringPrintf(fmt, ...) _StringPrintf(VARGS_CHECK(fmt, __VA_ARGS__), fmt, __VA_ARGS__)
@@ -71,6 +78,16 @@ inline void Zeroize(T &value)
     memset(&value, 0, sizeof(value));
 }
 
+// monotonic clock for timing
+inline uint64_t GetNanoseconds()
+{
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#include "trace.h"
+
 // c standard wrappers
 #if !defined(NDEBUG)
 #define Assert(cond)\
@@ -151,6 +168,13 @@ struct Breakpoint
     String cond;            
 };
 
+// breakpoints on one source line, for drawing the gutter
+struct BreakpointLine
+{
+    uint32_t count;
+    uint32_t num_disabled;
+};
+
 struct DisassemblyLine
 {
     uint64_t addr;
@@ -164,14 +188,69 @@ struct DisassemblySourceLine
     size_t line_idx;
 };
 
+// bytes of line index built by LoadFile, then per frame until the whole file is done
+#define FILE_INDEX_FIRST_SIZE (64 * 1024)
+#define FILE_INDEX_STEP_SIZE (4 * 1024 * 1024)
+
 struct File
 {
-    Vector<size_t> lines;   // offset to line within data
+    Vector<size_t> lines;   // start of each line within data, last entry is the end of the
+                            // last indexed line. empty until loaded
     String filename;
-    String data;            // file chars excluding line endings
+    const char *map;        // read only mapping of the file, NULL when held in buffer
+    size_t map_size;
+    String buffer;          // file chars when they couldn't be mapped
+    time_t mtime;           // modification time when loaded
+    size_t indexed_size;    // bytes scanned for line endings so far
     size_t longest_line_idx;// line with most chars, used for horizontal scrollbar 
+    size_t longest_line_size;
+
+    // source window pixel sizes, measured again when the font size changes
+    float metrics_font_size;
+    size_t metrics_longest_line_idx;
+    float longest_line_width;
+    float line_height;
+
+    HashMap<size_t, BreakpointLine> breakpoint_lines;   // line_idx -> breakpoints on it
+    uint64_t last_used;     // SourceCache tick of the last UseFile
+    size_t cache_bytes;     // what this file last added to SourceCache.resident_bytes
+    bool pinned;            // text from SetFileText, nothing on disk to load it again from
+};
+
+// loaded file contents, the least recently used mapped files
+// get unloaded past max_bytes and load again on their next UseFile
+struct SourceCache
+{
+    size_t max_bytes = 256 * 1024 * 1024;
+    uint64_t tick;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t resident_bytes;      // file bytes plus line index of every loaded file, except pinned ones
+    size_t num_resident;
 };
 
+inline const char *GetFileData(const File &file)
+{
+    return (file.map != NULL) ? file.map : file.buffer.data();
+}
+
+inline size_t GetFileSize(const File &file)
+{
+    return (file.map != NULL) ? file.map_size : file.buffer.size();
+}
+
+// lines indexed so far, see IsFileIndexed for whether that's all of them
+inline size_t GetLineCount(const File &file)
+{
+    return (file.lines.size() > 0) ? file.lines.size() - 1 : 0;
+}
+
+inline bool IsFileIndexed(const File &file)
+{
+    return file.lines.size() > 0 && file.lines.back() == GetFileSize(file);
+}
+
 #define INVALID_BLOCK_STRING_IDX 0
 
 enum AtomType
@@ -183,25 +262,97 @@ enum AtomType
     Atom_String,
 };
 
+// non-owning text inside another buffer, not null terminated
+struct StringView
+{
+    const char *data;
+    size_t size;
+};
+
+inline bool operator==(const StringView &view, const char *str)
+{
+    size_t len = strlen(str);
+    return (view.size == len && 0 == memcmp(view.data, str, len));
+}
+
+inline bool operator==(const char *str, const StringView &view)
+{
+    return (view == str);
+}
+
+inline bool operator!=(const StringView &view, const char *str)
+{
+    return !(view == str);
+}
+
+inline String ToString(const StringView &view)
+{
+    return (view.size > 0) ? String(view.data, view.size) : String();
+}
+
 // range of data that lives inside another buffer
 struct Span
 {
-    size_t index;
-    size_t length;
+    uint32_t index;
+    uint32_t length;
 };
 
+// packed to 16 bytes, records with lots of frames/variables get iterated
+// every time something gets looked up
 struct RecordAtom
 {
-    AtomType type;
+    AtomType type : 7;
+    uint32_t has_escapes : 1;   // string value still has \\ or \" in it, until GDB_UnescapeRecord
+
 
     // text span inside Record.buf
-    Span name;
+    uint32_t name_length : 24;
+    uint32_t name_index;
 
     // variant variable based upon type
     // array/struct= array span inside Record.atoms
     // string= text span inside Record.buf
     Span value;
 };
+static_assert(sizeof(RecordAtom) == 16, "RecordAtom should stay packed");
+
+// first word after the record type char, ex: ^done, *stopped, =thread-created
+enum RecordAction
+{
+    Action_Unknown,
+
+    // result records
+    Action_Done,
+    Action_Running,
+    Action_Connected,
+    Action_Error,
+    Action_Exit,
+
+    // async records
+    Action_Stopped,
+    Action_ThreadGroupAdded,
+    Action_ThreadGroupRemoved,
+    Action_ThreadGroupStarted,
+    Action_ThreadGroupExited,
+    Action_ThreadCreated,
+    Action_ThreadExited,
+    Action_ThreadSelected,
+    Action_LibraryLoaded,
+    Action_LibraryUnloaded,
+    Action_TraceframeChanged,
+    Action_TsvCreated,
+    Action_TsvDeleted,
+    Action_TsvModified,
+    Action_BreakpointCreated,
+    Action_BreakpointModified,
+    Action_BreakpointDeleted,
+    Action_RecordStarted,
+    Action_RecordStopped,
+    Action_CmdParamChanged,
+    Action_MemoryChanged,
+
+    Action_Count,
+};
 
 struct Record
 {
@@ -214,6 +365,17 @@ struct Record
 
     // line buffer, RecordAtom name/value strings point to data inside this
     String buf;
+
+    // hashed atom names for lookups, parallel to atoms. can be empty for
+    // records that get built by hand
+    Vector<uint32_t> name_hashes;
+
+    // open addressed (first child index, name hash) -> atom index + 1 of
+    // every named child, 0 is an empty slot. empty along with name_hashes
+    Vector<uint32_t> name_slots;
+
+    // classified once when the line gets parsed
+    RecordAction action;
 };
 
 struct RecordHolder
@@ -222,6 +384,19 @@ struct RecordHolder
     Record rec;
 };
 
+// RecordLine/read buffers bigger than this get freed instead of reused
+#define RECORD_LINE_KEEP_SIZE (1024 * 1024)
+
+// interpreter line parsed on the reader thread, handed to the UI thread
+struct RecordLine
+{
+    String text;        // line as it gets written to the console
+    bool is_prompt;     // (gdb) line, not written to the console
+    bool is_record;     // rec holds a parsed result/async record
+    uint64_t read_ns;   // GetNanoseconds when the reader thread got the line
+    Record rec;
+};
+
 struct VarObj
 {
     String name;
@@ -278,6 +453,56 @@ const size_t BAD_INDEX = ~0;
 #define FILE_IDX_INVALID 0
 
 
+// blocking command waiting on its result record, slot is picked by token
+struct PendingCommand
+{
+    uint32_t id;            // MI token, 0 when the slot is unused
+    bool completed;         // reader thread published the result record
+    bool wake;              // reader thread wants the ring drained
+    size_t rec_idx;         // result index in prog.read_recs, UI thread only
+    pthread_cond_t cond;
+};
+
+// result handler for GDB_SendAsync, ok is false on an error record
+typedef std::function<void(const Record &rec, bool ok)> AsyncCallback;
+
+struct AsyncCommand
+{
+    uint32_t id;                        // MI token of the sent command
+    bool echo_no_symbol_in_context;     // echo_next_no_symbol_in_context at send time
+    size_t trace_stat;                  // round trip stat, TRACE_STAT_INVALID when not tracing
+    uint64_t sent_ns;
+    uint64_t deadline_ns;               // callback gets ok = false if there's no result by then
+    AsyncCallback callback;
+};
+
+// MI command shown in the traffic window, UI thread only
+struct SentCommand
+{
+    uint32_t id;                // MI token
+    String text;                // command without the token
+    size_t stats_idx;           // index in gdb.command_stats
+    uint64_t send_ns;
+    uint64_t reply_ns;          // 0 until the result record is read
+    size_t reply_bytes;
+    size_t reply_atoms;
+    bool error;
+    bool timed_out;
+};
+
+// SentCommand totals for one MI operation i.e. -var-update
+struct CommandStats
+{
+    String verb;
+    size_t count;
+    size_t num_replies;
+    size_t num_errors;
+    size_t num_timeouts;
+    uint64_t total_bytes;
+    uint64_t total_latency_ns;
+    uint64_t max_latency_ns;
+};
+
 struct GDB
 {
     pid_t spawned_pid;      // process running GDB
@@ -287,14 +512,13 @@ struct GDB
     String args;            // args passed to spawned GDB 
     String ptty_slave;
     int fd_ptty_master;
+    int fd_ptty_slave;      // held open so the master doesn't hang up between runs
     
     bool end_program;
     pthread_t thread_read_interp;
+    pthread_t thread_read_inferior;     // inferior output from fd_ptty_master
     //pthread_t thread_write_stdin;
 
-    sem_t *recv_block;
-    pthread_mutex_t modify_block;
-
     // MI command sent from GDB
     int fd_in_read;
     int fd_in_write;
@@ -307,10 +531,41 @@ struct GDB
     // GDB_SendBlocking record sent
     uint32_t record_id = 1;
 
-    // raw data, guarded by modify_storage_lock
-    // a block is one or more Records
-    char block_data[1024 * 1024];
-    Vector<Span> block_spans;    // pipe read span into block_data
+    // lines parsed by the reader thread, the UI thread gives them back
+    // through free_lines once the records have been taken out
+    SPSCRing<RecordLine *> from_gdb;
+    SPSCRing<RecordLine *> free_lines;
+
+    // GDB_SendBlocking commands in flight, guarded by pending_lock
+    pthread_mutex_t pending_lock;
+    PendingCommand pending[64];
+    bool initialized_pending;
+    int command_timeout_ms = 5000;  // default wait for a result record
+
+    // --record transcript of the GDB traffic, NULL when not recording
+    FILE *transcript;
+
+    // --replay transcript that answers commands instead of a GDB process
+    String replay_filename;
+
+    // interpreter lines longer than this get dropped by the reader thread
+    // and replaced with an error, set before the reader thread starts
+    size_t max_record_size = 512 * 1024 * 1024;
+#define MAX_RECORD_SIZE_MIN_MB 1
+#define MAX_RECORD_SIZE_MAX_MB 4095     // record offsets are uint32_t
+
+    // lines dropped for going over max_record_size, counted by the reader thread
+    std::atomic<size_t> num_dropped_records;
+    std::atomic<uint64_t> dropped_bytes;
+
+    // GDB_SendAsync commands in flight, UI thread only
+    HashMap<uint32_t, AsyncCommand> async_cmds;     // MI token -> command waiting on a result
+
+    // every tokened command sent and its reply, oldest ones get dropped
+    // past SENT_COMMANDS_KEEP. totals are kept for the whole session
+    Vector<SentCommand> sent_cmds;
+    Vector<CommandStats> command_stats;
+    uint64_t traffic_start_ns;      // send_ns of the first command, times are shown from here
 
     // capabilities of the spawned GDB process using -list-features 
     bool has_frozen_varobj;
@@ -334,12 +589,60 @@ struct GDB
                                             // useful sometimes but mostly gets spammed in console
 };
 
+// console text is appended to a per-session spill file and kept in fixed
+// size chunks, only the newest chunks stay resident. older text is read
+// back through mmap windows of the spill file. lines can straddle chunks
+#define CONSOLE_CHUNK_SIZE ((size_t)256 * 1024)
+#define CONSOLE_MAX_LINE_SIZE ((size_t)1024 * 1024)
+#define CONSOLE_INDEX_STRIDE 32                     // lines per line_offsets entry
+#define CONSOLE_MAP_SIZE ((size_t)4 * 1024 * 1024)  // spill file window size
+
+struct ConsoleMapping
+{
+    uint64_t offset;        // multiple of CONSOLE_MAP_SIZE
+    size_t size;            // bytes mapped, less than CONSOLE_MAP_SIZE at the end of the file
+    char *data;             // NULL when unused
+    uint64_t last_used;
+};
+
+// wall clock time of the console output, at most one per second
+struct ConsoleMarker
+{
+    time_t time;
+    size_t line;            // first line written at this time
+};
+
+struct ConsoleLog
+{
+    Vector<char *> chunks;          // chunks[i] holds log bytes from (first_chunk + i) * CONSOLE_CHUNK_SIZE
+    size_t first_chunk;
+    size_t max_resident_chunks = 256;
+    uint64_t size;                  // total bytes ever appended, newlines included
+
+    // sparse line index, line_offsets[i] is where line first_line + i * CONSOLE_INDEX_STRIDE starts
+    Vector<uint64_t> line_offsets;
+    size_t num_lines;               // lines ever started, the last one may be open
+    size_t first_line;              // oldest readable line, only moves without a spill file
+    bool line_open;                 // last line hasn't seen its newline yet
+    size_t open_line_size;
+
+    // read position of the last ConsoleGetLine, rows are usually read in order
+    size_t cursor_line;
+    uint64_t cursor_offset;
+
+    Vector<ConsoleMarker> markers;
+
+    int fd = -1;                    // spill file, -1 keeps everything in the resident chunks
+    String filename;
+    uint64_t spilled;               // bytes written to the spill file
+    ConsoleMapping maps[4];
+    uint64_t map_counter;
+};
+
 struct Program
 {
-    // console messages ordered from newest to oldest
-    char log[64 * 1024];
-    bool log_scroll_to_bottom = true;
-    size_t log_idx;
+    // console messages ordered from oldest to newest
+    ConsoleLog log;
 
     // GDB console history buffer
     String input_cmd_data;
@@ -353,12 +656,17 @@ struct Program
     bool started;
     bool source_out_of_date;
     Vector<Breakpoint> breakpoints;
+    HashMap<size_t, size_t> breakpoint_numbers;                 // number -> index in breakpoints
+    std::unordered_multimap<uint64_t, size_t> breakpoint_addrs; // addr -> number
     // TODO: threads, active_thread
 
     Vector<RecordHolder> read_recs;
     size_t num_recs;
 
-    Vector<File> files;
+    Vector<File> files;             // never removed from, frames and breakpoints keep the index
+    HashMap<String, size_t> file_paths;         // realpath -> index in files
+    HashMap<String, size_t> file_spellings;     // path as given by GDB or the user -> index in files
+    SourceCache source_cache;
     Vector<Thread> threads;
     Vector<Frame> frames;
     size_t frame_idx = BAD_INDEX;
@@ -373,8 +681,35 @@ extern GDB gdb;
 
 const char *GetErrorString(int _errno);
 void WriteToConsoleBuffer(const char *raw, size_t rawsize);
+void WakeUIThread();
 bool VerifyFileExecutable(const char *filename);
 bool DoesFileExist(const char *filename, bool print_error_on_missing = true);
 bool DoesProcessExist(pid_t p);
 bool InvokeShellCommand(String command, String &output);
 void TrimWhitespace(String &str);
+
+// console.cpp
+void ConsoleDecode(const char *buf, size_t bufsize, bool unescape, String &out);
+void ConsoleAppend(ConsoleLog &log, const char *text, size_t size);
+bool ConsoleOpenSpill(ConsoleLog &log, const char *dirname);
+void ConsoleFlush(ConsoleLog &log);
+void ConsoleClose(ConsoleLog &log);
+size_t ConsoleNumLines(const ConsoleLog &log);
+size_t ConsoleFirstLine(const ConsoleLog &log);
+StringView ConsoleGetLine(ConsoleLog &log, size_t row, String &scratch);
+size_t ConsoleFindOffset(ConsoleLog &log, uint64_t offset);
+
+// source.cpp
+bool LoadFile(File &file);
+void UnloadFile(File &file);
+bool IsFileStale(const File &file);
+void SetFileText(File &file, String text);
+bool UseFile(SourceCache &cache, Vector<File> &files, size_t file_idx);    // load if needed, false on failure
+void TrimSourceCache(SourceCache &cache, Vector<File> &files, size_t keep_idx);    // count keep_idx again, unload past max_bytes
+bool IndexFileLines(File &file, size_t max_bytes);  // true while there is more to index
+bool IndexFileLinesTo(File &file, size_t line_idx); // true when line_idx exists
+StringView GetLine(const File &file, size_t line_idx);  // without the line ending
+
+// varobj.cpp
+VarObj CreateVarObj(String name, String value = "");
+void CheckIfChanged(VarObj &this_var, const VarObj &last_var);
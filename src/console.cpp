@@ -0,0 +1,527 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// console scrollback, no GUI dependencies so the benchmark can link this
+
+#include <algorithm>
+#include <dirent.h>
+#include <sys/mman.h>
+#include "common.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline bool IsConsoleSpecial(char c, bool unescape)
+{
+    // anything that can't be copied through as is: newlines, other
+    // control chars, non-ascii and escapes in console records
+    return (unsigned char)(c - ' ') > ('~' - ' ') || (unescape && c == '\\');
+}
+
+// index of the next special char at or after i, bufsize when there are none
+static size_t FindConsoleSpecial(const char *buf, size_t i, size_t bufsize, bool unescape)
+{
+#if defined(__SSE2__)
+    // printable is 0x20..0x7e, shift it down to signed -128..-34 so one
+    // signed compare finds everything outside of it
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - ' '));
+    const __m128i last_printable = _mm_set1_epi8((char)('~' - ' ' - 0x80));
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= bufsize; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i outside = _mm_cmpgt_epi8(_mm_add_epi8(v, bias), last_printable);
+        if (unescape)
+            outside = _mm_or_si128(outside, _mm_cmpeq_epi8(v, backslash));
+
+        int mask = _mm_movemask_epi8(outside);
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; i < bufsize; i++)
+        if (IsConsoleSpecial(buf[i], unescape))
+            break;
+
+    return i;
+}
+
+void ConsoleDecode(const char *buf, size_t bufsize, bool unescape, String &out)
+{
+    out.clear();
+    out.reserve(bufsize);
+
+    size_t i = 0;
+    while (i < bufsize)
+    {
+        // copy the run of plain text up to the next special char
+        size_t end = FindConsoleSpecial(buf, i, bufsize, unescape);
+        out.append(buf + i, end - i);
+        if (end == bufsize)
+            break;
+
+        char c = buf[end];
+        i = end + 1;
+        if (c == '\n')
+        {
+            out += '\n';
+        }
+        else if (c == '\\')
+        {
+            char n = (i < bufsize) ? buf[i] : '\0';
+            switch (n)
+            {
+                case 'n': out += '\n'; break;
+                case 't': out += "  "; break;
+                case '\\':
+                case '\"': out += n; break;
+                default: break;
+            }
+
+            i++; // skip over the evaluated literal char
+        }
+        // else drop other control chars and non-ascii
+    }
+}
+
+// spill files of older sessions past this many get deleted
+#define CONSOLE_KEEP_SESSIONS 8
+
+static inline uint64_t ResidentStart(const ConsoleLog &log)
+{
+    return (uint64_t)log.first_chunk * CONSOLE_CHUNK_SIZE;
+}
+
+static ConsoleMapping *GetMapping(ConsoleLog &log, uint64_t offset)
+{
+    uint64_t window = offset - (offset % CONSOLE_MAP_SIZE);
+    ConsoleMapping *result = NULL;
+    for (ConsoleMapping &map : log.maps)
+    {
+        if (map.data != NULL && map.offset == window && offset < map.offset + map.size)
+        {
+            result = &map;
+            break;
+        }
+    }
+
+    if (result == NULL)
+    {
+        // replace an unused or the least recently used window, the file
+        // may have grown since a window at this offset got mapped
+        result = &log.maps[0];
+        for (ConsoleMapping &map : log.maps)
+        {
+            if (map.data == NULL || map.last_used < result->last_used)
+                result = &map;
+            if (map.data == NULL)
+                break;
+        }
+
+        if (result->data != NULL)
+            munmap(result->data, result->size);
+
+        size_t size = GetMin(CONSOLE_MAP_SIZE, (size_t)(log.spilled - window));
+        void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, log.fd, (off_t)window);
+        if (data == MAP_FAILED)
+        {
+            fprintf(stderr, "console mmap %s\n", GetErrorString(errno));
+            *result = {};
+            return NULL;
+        }
+
+        result->offset = window;
+        result->size = size;
+        result->data = (char *)data;
+    }
+
+    result->last_used = ++log.map_counter;
+    return result;
+}
+
+static void UnmapAll(ConsoleLog &log)
+{
+    for (ConsoleMapping &map : log.maps)
+    {
+        if (map.data != NULL)
+            munmap(map.data, map.size);
+        map = {};
+    }
+}
+
+// longest contiguous run of log bytes starting at offset, NULL if unreadable
+static const char *ReadSpan(ConsoleLog &log, uint64_t offset, size_t &len)
+{
+    len = 0;
+    if (offset >= log.size)
+        return NULL;
+
+    if (offset >= ResidentStart(log))
+    {
+        size_t chunk_offset = offset % CONSOLE_CHUNK_SIZE;
+        len = GetMin(CONSOLE_CHUNK_SIZE - chunk_offset, (size_t)(log.size - offset));
+        return log.chunks[ offset / CONSOLE_CHUNK_SIZE - log.first_chunk ] + chunk_offset;
+    }
+
+    // older than the hot tail, read back from the spill file
+    if (log.fd < 0 || offset >= log.spilled)
+        return NULL;
+
+    ConsoleMapping *map = GetMapping(log, offset);
+    if (map == NULL)
+        return NULL;
+
+    len = map->offset + map->size - offset;
+    return map->data + (offset - map->offset);
+}
+
+// offset of the next newline at or after offset, log.size when there is none
+static uint64_t FindNewline(ConsoleLog &log, uint64_t offset)
+{
+    while (offset < log.size)
+    {
+        size_t len = 0;
+        const char *span = ReadSpan(log, offset, len);
+        if (span == NULL)
+            break;
+
+        const char *newline = (const char *)memchr(span, '\n', len);
+        if (newline != NULL)
+            return offset + (newline - span);
+
+        offset += len;
+    }
+
+    return log.size;
+}
+
+// without a spill file, text that goes away takes its lines with it
+static void DropLinesBefore(ConsoleLog &log, uint64_t keep_offset)
+{
+    if (log.line_offsets.size() == 0)
+        return;
+
+    // whole index strides at a time, the first kept line has to start in kept text
+    size_t num_drop = std::lower_bound(log.line_offsets.begin(), log.line_offsets.end(), keep_offset) - 
+                      log.line_offsets.begin();
+    num_drop = GetMin(num_drop, log.line_offsets.size() - 1);
+    if (num_drop == 0)
+        return;
+
+    log.line_offsets.erase(log.line_offsets.begin(), log.line_offsets.begin() + num_drop);
+    log.first_line += num_drop * CONSOLE_INDEX_STRIDE;
+    log.cursor_line = 0;
+}
+
+static void FreeChunksBefore(ConsoleLog &log, uint64_t offset)
+{
+    size_t num_free = 0;
+    while (num_free < log.chunks.size() &&
+           (log.first_chunk + num_free + 1) * CONSOLE_CHUNK_SIZE <= offset)
+    {
+        free(log.chunks[num_free++]);
+    }
+
+    log.chunks.erase(log.chunks.begin(), log.chunks.begin() + num_free);
+    log.first_chunk += num_free;
+}
+
+static void TrimResident(ConsoleLog &log)
+{
+    if (log.chunks.size() <= log.max_resident_chunks)
+        return;
+
+    uint64_t keep_offset = ResidentStart(log) + 
+        (uint64_t)(log.chunks.size() - log.max_resident_chunks) * CONSOLE_CHUNK_SIZE;
+
+    if (log.fd >= 0)
+        ConsoleFlush(log);
+
+    if (log.fd < 0)
+    {
+        DropLinesBefore(log, keep_offset);
+        keep_offset = GetMin(keep_offset, log.line_offsets[0]);
+    }
+
+    FreeChunksBefore(log, keep_offset);
+}
+
+// returns the amount appended, short when out of memory
+static size_t AppendBytes(ConsoleLog &log, const char *text, size_t size)
+{
+    size_t result = 0;
+    while (size > 0)
+    {
+        size_t chunk_offset = log.size % CONSOLE_CHUNK_SIZE;
+        if (chunk_offset == 0)
+        {
+            char *chunk = (char *)malloc(CONSOLE_CHUNK_SIZE);
+            if (chunk == NULL)
+            {
+                // not PrintError, that writes back into the console
+                fprintf(stderr, "out of memory for console chunk\n");
+                break;
+            }
+
+            if (log.chunks.size() == 0)
+                log.first_chunk = log.size / CONSOLE_CHUNK_SIZE;
+            log.chunks.push_back(chunk);
+        }
+
+        size_t n = GetMin(size, CONSOLE_CHUNK_SIZE - chunk_offset);
+        memcpy(log.chunks.back() + chunk_offset, text, n);
+        log.size += n;
+        text += n;
+        size -= n;
+        result += n;
+    }
+
+    return result;
+}
+
+void ConsoleAppend(ConsoleLog &log, const char *text, size_t size)
+{
+    if (size == 0)
+        return;
+
+    time_t now = time(NULL);
+    if (log.markers.size() == 0 || log.markers.back().time != now)
+    {
+        ConsoleMarker add = {};
+        add.time = now;
+        add.line = (log.line_open) ? log.num_lines - 1 : log.num_lines;
+        log.markers.push_back(add);
+    }
+
+    const char *end = text + size;
+    while (text < end)
+    {
+        if (!log.line_open)
+        {
+            if (log.num_lines % CONSOLE_INDEX_STRIDE == 0)
+                log.line_offsets.push_back(log.size);
+
+            log.num_lines++;
+            log.line_open = true;
+            log.open_line_size = 0;
+        }
+
+        const char *newline = (const char *)memchr(text, '\n', end - text);
+        const char *line_end = (newline != NULL) ? newline : end;
+
+        // overlong lines get cut off instead of taking up the scrollback
+        size_t n = GetMin((size_t)(line_end - text), CONSOLE_MAX_LINE_SIZE - log.open_line_size);
+        log.open_line_size += AppendBytes(log, text, n);
+
+        if (newline != NULL)
+        {
+            AppendBytes(log, "\n", 1);
+            log.line_open = false;
+            text = newline + 1;
+        }
+        else
+        {
+            text = end;
+        }
+    }
+
+    TrimResident(log);
+}
+
+static void PruneOldSpillFiles(const char *dirname)
+{
+    // names start with the session time so they sort oldest first
+    DIR *dir = opendir(dirname);
+    if (dir == NULL)
+        return;
+
+    Vector<String> names;
+    while (struct dirent *entry = readdir(dir))
+    {
+        size_t len = strlen(entry->d_name);
+        if (0 == strncmp(entry->d_name, "console-", 8) &&
+            len > 4 && 0 == strcmp(entry->d_name + len - 4, ".log"))
+        {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i + CONSOLE_KEEP_SESSIONS <= names.size(); i++)
+    {
+        String path = StringPrintf("%s/%s", dirname, names[i].c_str());
+        unlink(path.c_str());
+    }
+}
+
+bool ConsoleOpenSpill(ConsoleLog &log, const char *dirname)
+{
+    // file offsets are log offsets, nothing can have been freed yet
+    if (log.fd >= 0 || log.first_chunk != 0)
+        return false;
+
+    PruneOldSpillFiles(dirname);
+
+    char name[64];
+    time_t sec = time(NULL);
+    size_t len = strftime(name, sizeof(name), "/console-%Y%m%d-%H%M%S", localtime(&sec));
+    snprintf(name + len, sizeof(name) - len, "-%d.log", (int)getpid());
+
+    String path = String(dirname) + name;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        PrintErrorf("open console log %s %s\n", path.c_str(), GetErrorString(errno));
+        return false;
+    }
+
+    log.fd = fd;
+    log.filename = path;
+    log.spilled = 0;
+    ConsoleFlush(log);
+    return (log.fd >= 0);
+}
+
+void ConsoleFlush(ConsoleLog &log)
+{
+    // unwritten text is always resident, chunks only get freed once spilled
+    while (log.fd >= 0 && log.spilled < log.size)
+    {
+        size_t len = 0;
+        const char *span = ReadSpan(log, log.spilled, len);
+        ssize_t written = write(log.fd, span, len);
+        if (written < 0 && errno == EINTR)
+            continue;
+
+        if (written <= 0)
+        {
+            // keep going from memory, the text that was spilled can't be read anymore
+            fprintf(stderr, "console log %s write %s, no longer spilling to disk\n", 
+                    log.filename.c_str(), GetErrorString(errno));
+            UnmapAll(log);
+            close(log.fd);
+            log.fd = -1;
+            DropLinesBefore(log, ResidentStart(log));
+            break;
+        }
+
+        log.spilled += written;
+    }
+}
+
+void ConsoleClose(ConsoleLog &log)
+{
+    ConsoleFlush(log);
+    UnmapAll(log);
+    if (log.fd >= 0)
+    {
+        close(log.fd);
+        log.fd = -1;
+    }
+}
+
+size_t ConsoleNumLines(const ConsoleLog &log)
+{
+    return log.num_lines - log.first_line;
+}
+
+size_t ConsoleFirstLine(const ConsoleLog &log)
+{
+    return log.first_line;
+}
+
+StringView ConsoleGetLine(ConsoleLog &log, size_t row, String &scratch)
+{
+    StringView result = {};
+    size_t line = log.first_line + row;
+    if (line >= log.num_lines)
+        return result;
+
+    // walk from the closest index entry, or from the last read line
+    size_t stride_idx = row / CONSOLE_INDEX_STRIDE;
+    size_t this_line = log.first_line + stride_idx * CONSOLE_INDEX_STRIDE;
+    uint64_t offset = log.line_offsets[stride_idx];
+    if (log.cursor_line > this_line && log.cursor_line <= line)
+    {
+        this_line = log.cursor_line;
+        offset = log.cursor_offset;
+    }
+
+    for (; this_line < line; this_line++)
+        offset = FindNewline(log, offset) + 1;
+
+    uint64_t end = FindNewline(log, offset);
+    log.cursor_line = line + 1;
+    log.cursor_offset = end + 1;
+    if (end == offset)
+        return result;
+
+    size_t len = 0;
+    const char *span = ReadSpan(log, offset, len);
+    if (span == NULL)
+        return result;
+
+    if (len >= end - offset)
+    {
+        // usual case, no copy
+        result.data = span;
+        result.size = end - offset;
+    }
+    else
+    {
+        // line straddles chunks or windows, stitch it together
+        scratch.clear();
+        while (span != NULL && offset < end)
+        {
+            size_t n = GetMin(len, (size_t)(end - offset));
+            scratch.append(span, n);
+            offset += n;
+            span = ReadSpan(log, offset, len);
+        }
+
+        result.data = scratch.data();
+        result.size = scratch.size();
+    }
+
+    return result;
+}
+
+size_t ConsoleFindOffset(ConsoleLog &log, uint64_t offset)
+{
+    if (log.line_offsets.size() == 0)
+        return 0;
+
+    // last index entry at or before offset, then line by line
+    size_t stride_idx = std::upper_bound(log.line_offsets.begin(), log.line_offsets.end(), offset) - 
+                        log.line_offsets.begin();
+    stride_idx = (stride_idx > 0) ? stride_idx - 1 : 0;
+
+    size_t line = log.first_line + stride_idx * CONSOLE_INDEX_STRIDE;
+    uint64_t line_offset = log.line_offsets[stride_idx];
+    while (line + 1 < log.num_lines)
+    {
+        uint64_t newline = FindNewline(log, line_offset);
+        if (newline >= offset)
+            break;
+
+        line_offset = newline + 1;
+        line++;
+    }
+
+    return line - log.first_line;
+}
@@ -24,6 +24,7 @@ Source=1
 Control=1
 Breakpoints=0
 Threads=0
+MITraffic=0
 Registers=0
 DirectoryViewer=1
 FontFilename=
@@ -16,87 +16,529 @@
 #include "common.h"
 #include "gdb.h"
 
-static ssize_t read_block_maxsize = 0;
-void *GDB_ReadInterpreterBlocks(void *)
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// tell blocking commands to drain the ring, either their result is stuck
+// behind a full ring or it's never going to come
+static void WakePendingCommands()
+{
+    pthread_mutex_lock(&gdb.pending_lock);
+    for (PendingCommand &iter : gdb.pending)
+    {
+        if (iter.id != 0)
+        {
+            iter.wake = true;
+            pthread_cond_signal(&iter.cond);
+        }
+    }
+    pthread_mutex_unlock(&gdb.pending_lock);
+}
+
+// --record transcript, one entry per pipe read or GDB_Send
+// 
+// # tug transcript 1
+// <seconds>.<microseconds> <direction> <size>
+// <size bytes of MI traffic>
+static timeval transcript_start;
+
+static void RecordTraffic(char direction, const char *data, size_t size)
 {
-    // read data from GDB pipe
-    size_t insert_idx = 0;
-    size_t read_base_idx = 0;
-    bool set_read_start_idx = true;
+    timeval now = {};
+    gettimeofday(&now, NULL);
+    long long usec = (long long)(now.tv_sec - transcript_start.tv_sec) * 1000000 + 
+                     (now.tv_usec - transcript_start.tv_usec);
+
+    // both the UI and reader thread write entries, don't get cancelled 
+    // holding the file lock
+    int oldstate;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+    flockfile(gdb.transcript);
+    fprintf(gdb.transcript, "%lld.%06lld %c %zu\n", 
+            usec / 1000000, usec % 1000000, direction, size);
+    fwrite(data, 1, size, gdb.transcript);
+    fputc('\n', gdb.transcript);
+    fflush(gdb.transcript);
+    funlockfile(gdb.transcript);
+    pthread_setcancelstate(oldstate, NULL);
+}
 
-    while (true)
+static void PublishLine(const char *line, size_t linesize)
+{
+    // reuse a line the UI thread is done with when available
+    static ParseRecordContext ctx;
+    RecordLine *item = NULL;
+    if (0 == RingRead(gdb.free_lines, &item, 1))
+        item = new RecordLine;
+
+    GDB_ParseLine(line, linesize, ctx, *item);
+    item->read_ns = GetNanoseconds();
+
+    // item belongs to the UI thread once it's in the ring
+    uint32_t result_id = 0;
+    if (item->is_record && item->rec.buf[0] == PREFIX_RESULT)
+        result_id = item->rec.id;
+
+    int oldstate;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+    while (0 == RingWrite(gdb.from_gdb, &item, 1))
     {
-        if (set_read_start_idx)
-            read_base_idx = insert_idx;
+        // UI thread is behind, don't get cancelled holding the ring wait lock
+        WakePendingCommands();
+        RingWaitForSpace(gdb.from_gdb, 100);
+        pthread_setcancelstate(oldstate, NULL);
+        pthread_testcancel();
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+    }
 
-        if (ArrayCount(gdb.block_data) - insert_idx < 64 * 1024)
+    if (result_id != 0)
+    {
+        // only wake the command waiting on this token
+        pthread_mutex_lock(&gdb.pending_lock);
+        PendingCommand &pending = gdb.pending[ result_id % ArrayCount(gdb.pending) ];
+        if (pending.id == result_id)
         {
-            // wrap around to beginning, moving a partially made record if available
-            // TODO: is there a function call to see if there is more read data
-            memmove(gdb.block_data, gdb.block_data + read_base_idx, 
-                    insert_idx - read_base_idx);
-            insert_idx = (insert_idx - read_base_idx);
-            read_base_idx = 0;
+            pending.completed = true;
+            pthread_cond_signal(&pending.cond);
         }
+        pthread_mutex_unlock(&gdb.pending_lock);
+    }
+    pthread_setcancelstate(oldstate, NULL);
+}
+
+static void PublishDroppedLine(const char *head, size_t headsize, size_t linesize)
+{
+    gdb.num_dropped_records++;
+    gdb.dropped_bytes += linesize;
+
+    // keep the token so a command waiting on the result still completes
+    size_t idx = 0;
+    uint32_t id = 0;
+    for (; idx < headsize && head[idx] >= '0' && head[idx] <= '9'; idx++)
+        id = (id * 10) + (head[idx] - '0');
+
+    char prefix = (idx < headsize) ? head[idx] : '\0';
+    size_t limit_mb = gdb.max_record_size / (1024 * 1024);
+    char line[512];
+    if (prefix == PREFIX_RESULT)
+    {
+        tsnprintf(line, "%u^error,msg=\"result record of %zu bytes is over the "
+                  "MaxRecordSize limit of %zu MB\"\n", id, linesize, limit_mb);
+    }
+    else
+    {
+        tsnprintf(line, "&\"dropped %c line of %zu bytes, over the "
+                  "MaxRecordSize limit of %zu MB\\n\"\n", 
+                  (prefix != '\0') ? prefix : '?', linesize, limit_mb);
+    }
+
+    PublishLine(line, strlen(line));
+}
+
+void *GDB_ReadInterpreterBlocks(void *)
+{
+    // read data from GDB pipe, split it into lines and parse the records
+    // here so the UI thread only has to dispatch them
+    static char readbuf[64 * 1024];
+    String partial;     // line split across multiple pipe reads
 
-        ssize_t num_read = read(gdb.fd_in_read, gdb.block_data + insert_idx,
-                                ArrayCount(gdb.block_data) - insert_idx);
+    // line over gdb.max_record_size that is being skipped until its newline
+    bool dropping = false;
+    char dropped_head[32];
+    size_t dropped_headsize = 0;
+    size_t dropped_size = 0;
+
+    while (true)
+    {
+        ssize_t num_read = read(gdb.fd_in_read, readbuf, sizeof(readbuf));
         if (num_read < 0)
         {
+            if (errno == EINTR)
+                continue;
+
             fprintf(stderr, "gdb read %s\n", GetErrorString(errno));
             break;
         }
+        else if (num_read == 0)
+        {
+            // write end closed
+            break;
+        }
+
+        if (gdb.transcript)
+            RecordTraffic(TRANSCRIPT_FROM_GDB, readbuf, num_read);
 
-        static int iteration = 0;
-        //printf("~%d~\n%d - num read: %zu \n~%d~\n", iteration,
-        //       (int)gdb.block_data[ insert_idx + num_read - 1 ], 
-        //       (size_t)num_read, iteration);
 #if defined(DEBUG)
-        printf("~%d~\n%.*s\n~%d~\n", iteration, (int)num_read, 
-               gdb.block_data + insert_idx, iteration);
-#endif
+        static int iteration = 0;
+        printf("~%d~\n%.*s\n~%d~\n", iteration, (int)num_read, readbuf, iteration);
         iteration++;
-        insert_idx += num_read;
+#endif
 
-        if (gdb.block_data[ insert_idx - 1 ] != '\n')
+        const char *iter = readbuf;
+        const char *end = readbuf + num_read;
+        while (iter < end)
         {
-            // GDB blocks I've seen have a max of 64k, this record is
-            // split across multiple pipe reads
-            set_read_start_idx = false;
-            continue;
+            const char *eol = (const char *)memchr(iter, '\n', end - iter);
+            size_t linesize = (eol != NULL) ? eol + 1 - iter : end - iter;
+
+            if (!dropping && partial.size() + linesize > gdb.max_record_size)
+            {
+                // too big, keep the start for the token and skip the rest
+                const char *head = (partial.size() > 0) ? partial.data() : iter;
+                size_t available = (partial.size() > 0) ? partial.size() : linesize;
+                dropped_headsize = GetMin(available, sizeof(dropped_head));
+                memcpy(dropped_head, head, dropped_headsize);
+                dropped_size = partial.size();
+                dropping = true;
+                String().swap(partial);
+            }
+
+            if (dropping)
+            {
+                dropped_size += linesize;
+                if (eol != NULL)
+                {
+                    PublishDroppedLine(dropped_head, dropped_headsize, dropped_size);
+                    dropping = false;
+                }
+            }
+            else if (eol == NULL)
+            {
+                partial.append(iter, linesize);
+            }
+            else if (partial.size() > 0)
+            {
+                partial.append(iter, linesize);
+                PublishLine(partial.data(), partial.size());
+
+                // don't hold on to the memory of an unusually large record
+                if (partial.capacity() > RECORD_LINE_KEEP_SIZE)
+                    String().swap(partial);
+                else
+                    partial.clear();
+            }
+            else
+            {
+                PublishLine(iter, linesize);
+            }
+
+            iter += linesize;
         }
-        else
+
+        // once per read, the UI thread sleeps until there's something new
+        WakeUIThread();
+    }
+
+    int oldstate;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+    WakePendingCommands();
+    pthread_setcancelstate(oldstate, NULL);
+    WakeUIThread();
+    return NULL;
+}
+
+bool GDB_StartRecording(const char *filename)
+{
+    // a directory gets a new transcript named after the current time
+    String path = filename;
+    struct stat st = {};
+    if (0 == stat(filename, &st) && S_ISDIR(st.st_mode))
+    {
+        char name[64];
+        time_t sec = time(NULL);
+        strftime(name, sizeof(name), "/tug-%Y%m%d-%H%M%S.mi", localtime(&sec));
+        path += name;
+    }
+
+    gdb.transcript = fopen(path.c_str(), "wb");
+    if (gdb.transcript == NULL)
+    {
+        PrintErrorf("fopen %s %s\n", path.c_str(), GetErrorString(errno));
+        return false;
+    }
+
+    gettimeofday(&transcript_start, NULL);
+    fputs(TRANSCRIPT_HEADER, gdb.transcript);
+    Printf("recording GDB traffic to %s\n", path.c_str());
+    return true;
+}
+
+bool GDB_ParseTranscript(const String &data, Vector<TranscriptEntry> &out)
+{
+    size_t header_size = strlen(TRANSCRIPT_HEADER);
+    if (0 != data.compare(0, header_size, TRANSCRIPT_HEADER))
+        return false;
+
+    for (size_t i = header_size; i < data.size(); )
+    {
+        size_t eol = data.find('\n', i);
+        if (eol == String::npos)
+            return false;
+
+        // entry header followed by the raw bytes and a newline
+        unsigned long long sec = 0, usec = 0;
+        char direction = '\0';
+        size_t size = 0;
+        String header = data.substr(i, eol - i);
+        if (4 != sscanf(header.c_str(), "%llu.%llu %c %zu", &sec, &usec, &direction, &size) ||
+            (direction != TRANSCRIPT_TO_GDB && direction != TRANSCRIPT_FROM_GDB) ||
+            eol + 1 + size > data.size())
         {
-            set_read_start_idx = true;
+            return false;
         }
 
+        TranscriptEntry add = {};
+        add.time_us = sec * 1000000 + usec;
+        add.direction = direction;
+        add.data.assign(data, eol + 1, size);
+        out.push_back(add);
+        i = eol + 1 + size + 1;
+    }
+
+    return true;
+}
+
+bool GDB_LoadTranscript(const char *filename, Vector<TranscriptEntry> &out)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        PrintErrorf("fopen %s %s\n", filename, GetErrorString(errno));
+        return false;
+    }
+
+    String data;
+    char buf[64 * 1024];
+    size_t num_read = 0;
+    while (0 != (num_read = fread(buf, 1, sizeof(buf), f)))
+        data.append(buf, num_read);
+    fclose(f);
+
+    out.clear();
+    bool result = GDB_ParseTranscript(data, out);
+    if (!result)
+        PrintErrorf("bad transcript %s\n", filename);
+
+    return result;
+}
+
+static bool WriteAll(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
 
-        if (read_block_maxsize < num_read)
-            read_block_maxsize = num_read;
+        data += written;
+        size -= written;
+    }
 
-        pthread_mutex_lock(&gdb.modify_block);
+    return true;
+}
 
-        Span span = {};
-        span.index = read_base_idx; 
-        span.length = num_read;
-        gdb.block_spans.push_back(span);
+static uint32_t SplitCommandToken(const String &line, size_t &idx)
+{
+    uint32_t token = 0;
+    for (idx = 0; idx < line.size() && line[idx] >= '0' && line[idx] <= '9'; idx++)
+        token = (token * 10) + (line[idx] - '0');
+    return token;
+}
 
-        pthread_mutex_unlock(&gdb.modify_block);
+struct ReplayCommand
+{
+    uint32_t token;         // recorded MI token, 0 if it had none
+    String text;            // command without the token or newline
+    size_t entry_idx;       // index in the transcript
+    bool used;
+};
 
-        // post a change if the binary semaphore is zero
-        int semvalue; 
-        sem_getvalue(gdb.recv_block, &semvalue);
-        if (semvalue == 0) 
-            sem_post(gdb.recv_block);
+static void RunReplay(const Vector<TranscriptEntry> &entries, int fd_commands, int fd_output)
+{
+    // stand in for GDB: every command that gets sent is matched up to one 
+    // from the recording, then the output that followed it gets written back
+    Vector<ReplayCommand> cmds;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].direction == TRANSCRIPT_TO_GDB)
+        {
+            ReplayCommand add = {};
+            size_t idx = 0;
+            add.token = SplitCommandToken(entries[i].data, idx);
+            add.text = entries[i].data.substr(idx);
+            while (add.text.size() > 0 && (add.text.back() == '\n' || add.text.back() == '\r'))
+                add.text.pop_back();
+            add.entry_idx = i;
+            cmds.push_back(add);
+        }
     }
 
-    return NULL;
+    const auto WriteOutput = [&](size_t entry_idx, uint32_t recorded_token, uint32_t token)
+    {
+        String out;
+        for (size_t i = entry_idx; i < entries.size() && entries[i].direction == TRANSCRIPT_FROM_GDB; i++)
+            out += entries[i].data;
+
+        if (recorded_token != token && recorded_token != 0)
+        {
+            // result records carry the token of the session that was recorded
+            String replaced;
+            char prefix[32];
+            size_t prefix_size = (size_t)tsnprintf(prefix, "%u", recorded_token);
+            String new_prefix = (token != 0) ? StringPrintf("%u", token) : "";
+            for (size_t i = 0; i < out.size(); )
+            {
+                size_t eol = out.find('\n', i);
+                eol = (eol == String::npos) ? out.size() : eol + 1;
+                if (0 == out.compare(i, prefix_size, prefix) && 
+                    i + prefix_size < out.size() && 
+                    (out[i + prefix_size] < '0' || out[i + prefix_size] > '9'))
+                {
+                    replaced += new_prefix;
+                    replaced.append(out, i + prefix_size, eol - i - prefix_size);
+                }
+                else
+                {
+                    replaced.append(out, i, eol - i);
+                }
+                i = eol;
+            }
+            out.swap(replaced);
+        }
+
+        WriteAll(fd_output, out.data(), out.size());
+    };
+
+    // GDB startup output before the first command
+    WriteOutput(0, 0, 0);
+
+    // tokens only go up during a session, binary search them
+    Vector<size_t> by_token;
+    for (size_t i = 0; i < cmds.size(); i++)
+        if (cmds[i].token != 0)
+            by_token.push_back(i);
+
+    size_t first_unused = 0;
+    String partial;
+    char buf[4096];
+    while (true)
+    {
+        ssize_t num_read = read(fd_commands, buf, sizeof(buf));
+        if (num_read < 0 && errno == EINTR)
+            continue;
+        if (num_read <= 0)
+            break;
+
+        partial.append(buf, num_read);
+        size_t eol;
+        while (String::npos != (eol = partial.find('\n')))
+        {
+            String line = partial.substr(0, eol);
+            partial.erase(0, eol + 1);
+
+            size_t idx = 0;
+            uint32_t token = SplitCommandToken(line, idx);
+            String text = line.substr(idx);
+            while (text.size() > 0 && text.back() == '\r')
+                text.pop_back();
+
+            // prefer the same token and command, then the oldest unused copy
+            // of the command, then the same token and operation for commands 
+            // with session specific args like the pty name
+            size_t match = BAD_INDEX;
+            size_t token_match = BAD_INDEX;
+            if (token != 0)
+            {
+                auto it = std::lower_bound(by_token.begin(), by_token.end(), token, 
+                                           [&](size_t i, uint32_t t) { return cmds[i].token < t; });
+                if (it != by_token.end() && cmds[*it].token == token && !cmds[*it].used)
+                {
+                    const String &recorded = cmds[*it].text;
+                    size_t op_size = text.find(' ');
+                    if (recorded == text)
+                        match = *it;
+                    else if (op_size != String::npos && 0 == recorded.compare(0, op_size + 1, text, 0, op_size + 1))
+                        token_match = *it;
+                }
+            }
+
+            for (size_t i = first_unused; match == BAD_INDEX && i < cmds.size(); i++)
+                if (!cmds[i].used && cmds[i].text == text)
+                    match = i;
+
+            if (match == BAD_INDEX)
+                match = token_match;
+
+            if (match == BAD_INDEX)
+            {
+                String msg = (token != 0) ? StringPrintf("%u", token) : "";
+                msg += "^error,msg=\"no recorded response for ";
+                for (char c : text)
+                {
+                    if (c == '"' || c == '\\') msg += '\\';
+                    msg += c;
+                }
+                msg += "\"\n(gdb) \n";
+                WriteAll(fd_output, msg.data(), msg.size());
+                continue;
+            }
+
+            cmds[match].used = true;
+            while (first_unused < cmds.size() && cmds[first_unused].used)
+                first_unused++;
+
+            WriteOutput(cmds[match].entry_idx + 1, cmds[match].token, token);
+        }
+    }
+}
+
+static bool StartReplayProcess(const String &filename)
+{
+    Vector<TranscriptEntry> entries;
+    if (!GDB_LoadTranscript(filename.c_str(), entries))
+        return false;
+
+    // fork so the replay gets treated like any other GDB process
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        PrintErrorf("fork %s\n", GetErrorString(errno));
+        return false;
+    }
+    else if (pid == 0)
+    {
+        // only the pipes GDB would have, ctrl-c is for tug
+        signal(SIGINT, SIG_IGN);
+        close(gdb.fd_in_read);
+        close(gdb.fd_out_write);
+        RunReplay(entries, gdb.fd_out_read, gdb.fd_in_write);
+        _exit(0);
+    }
+
+    gdb.spawned_pid = pid;
+    Printf("replaying %s\n", filename.c_str());
+    return true;
 }
 
 bool GDB_StartProcess(String gdb_filename, String gdb_args)
 {
     int rc = 0;
-    if (!VerifyFileExecutable(gdb_filename.c_str()))
+
+    // nothing sent to the last GDB will get a result
+    gdb.async_cmds.clear();
+    if (gdb.replay_filename != "")
+    {
+        if (!StartReplayProcess(gdb.replay_filename))
+            return false;
+    }
+    else if (!VerifyFileExecutable(gdb_filename.c_str()))
     {
         return false;
     }
@@ -378,192 +820,347 @@ static AtomType InferAtomStart(char c)
     return result;
 }
 
-static void PushUnorderedAtom(ParseRecordContext &ctx, RecordAtom atom)
+static void PushChildAtom(ParseRecordContext &ctx, const RecordAtom &atom)
 {
-    Assert(ctx.num_end_atoms <= ctx.atoms.size() &&
-           ctx.atom_idx < ctx.atoms.size() - ctx.num_end_atoms);
-    memcpy(&ctx.atoms[ ctx.atom_idx ], &atom, sizeof(atom));
-    ctx.atom_idx++;
+    // children stay pending until their aggregate closes
+    ctx.pending.push_back(atom);
 }
 
-static RecordAtom PopUnorderedAtom(ParseRecordContext &ctx, size_t start_idx)
+static Span PopChildAtoms(ParseRecordContext &ctx, size_t start_idx)
 {
-    // pop unordered atoms to the end of the array 
-    RecordAtom result = {};
-    Assert(start_idx <= ctx.atom_idx);
-    size_t num_atoms = ctx.atom_idx - start_idx;
-    Assert(ctx.atom_idx + num_atoms < ctx.atoms.size());
+    // aggregate closed, append its children to the output as one block,
+    // nothing that gets written to ctx.atoms moves afterwards
+    Span result = {};
+    Assert(start_idx <= ctx.pending.size());
+    size_t num_atoms = ctx.pending.size() - start_idx;
+    if (num_atoms > 0)
+    {
+        result.index = ctx.atoms.size();
+        result.length = num_atoms;
+        ctx.atoms.insert(ctx.atoms.end(), ctx.pending.begin() + start_idx, 
+                         ctx.pending.end());
+        ctx.pending.resize(start_idx);
+    }
 
-    RecordAtom *dest = 
-        &ctx.atoms[ ctx.atoms.size() - ctx.num_end_atoms - num_atoms ];
-    memmove(dest, &ctx.atoms[ start_idx ],
-            num_atoms * sizeof(RecordAtom));
+    return result;
+}
 
-    ctx.num_end_atoms += num_atoms;
-    result.value.length = num_atoms;
-    result.value.index = (num_atoms == 0) ? 0 : dest - &ctx.atoms[0];
+// chars shown on each side of a parse error
+#define PARSE_ERROR_CONTEXT 64
 
-    // clear the popped memory
-    ctx.atom_idx -= num_atoms;
-    //memset(ctx.atoms + ctx.atom_idx, 0, num_atoms * sizeof(RecordAtom));
+static void SetParseError(ParseRecordContext &ctx, const char *message)
+{
+    // stop parsing, caller reports the error
+    if (!ctx.error)
+    {
+        ctx.error = true;
+        ctx.error_message = message;
+        ctx.error_idx = ctx.i;
+    }
+    ctx.i = ctx.bufsize;
+}
 
-    return result;
+// per-char bitmasks of a 64 byte block, bit n = block[n]
+struct BlockMasks
+{
+    uint64_t quote;         // "
+    uint64_t backslash;     // backslash
+    uint64_t structural;    // { } [ ] , =
+    uint64_t eval;          // , } = \ < used by GDB_RecurseEvaluation
+};
+
+#if defined(__SSE2__)
+static inline uint64_t MatchChar16(__m128i v, char c, int shift)
+{
+    __m128i eq = _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(eq) << shift;
 }
 
-static RecordAtom RecurseRecord(ParseRecordContext &ctx)
+static void ClassifyBlock(const char *block, BlockMasks &masks)
+{
+    masks = {};
+    for (int i = 0; i < 64; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        uint64_t comma = MatchChar16(v, ',', i);
+        uint64_t equal = MatchChar16(v, '=', i);
+        uint64_t close_brace = MatchChar16(v, '}', i);
+        uint64_t backslash = MatchChar16(v, '\\', i);
+
+        masks.quote |= MatchChar16(v, '"', i);
+        masks.backslash |= backslash;
+        masks.structural |= comma | equal | close_brace |
+                            MatchChar16(v, '{', i) | 
+                            MatchChar16(v, '[', i) | 
+                            MatchChar16(v, ']', i);
+        masks.eval |= comma | equal | close_brace | backslash | MatchChar16(v, '<', i);
+    }
+}
+#else
+static void ClassifyBlock(const char *block, BlockMasks &masks)
 {
-    static const auto RecurseError = [&](const char *message, char error_char)
+    masks = {};
+    for (int i = 0; i < 64; i++)
     {
-        fprintf(stderr, "parse record error: %s\n", message);
-        fprintf(stderr, "   before error: %.*s\n", int(ctx.i), ctx.buf);
-        fprintf(stderr, "   error char: %c\n", error_char);
-        fprintf(stderr, "   after error: %.*s\n", int(ctx.bufsize - (ctx.i + 1)), ctx.buf + ctx.i + 1);
+        uint64_t bit = (uint64_t)1 << i;
+        switch (block[i])
+        {
+            case '"': masks.quote |= bit; break;
+            case '\\': masks.backslash |= bit; masks.eval |= bit; break;
+            case ',': case '=': case '}': masks.structural |= bit; masks.eval |= bit; break;
+            case '{': case '[': case ']': masks.structural |= bit; break;
+            case '<': masks.eval |= bit; break;
+        }
+    }
+}
+#endif
 
-        timeval te;
-        gettimeofday(&te, NULL); // get current time
-        long long msec = te.tv_sec*1000LL + te.tv_usec/1000; 
+static uint64_t FindEscapedChars(uint64_t backslash, uint64_t &prev_escaped)
+{
+    // chars preceded by an odd length run of backslashes, runs can
+    // carry over from the previous block
+    const uint64_t EVEN_BITS = 0x5555555555555555ULL;
+    backslash &= ~prev_escaped;
+    uint64_t follows_escape = (backslash << 1) | prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~EVEN_BITS & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    prev_escaped = (sequences_starting_on_even_bits < backslash) ? 1 : 0;
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (EVEN_BITS ^ invert_mask) & follows_escape;
+}
 
-        char filename[128]; 
-        tsnprintf(filename, "badrecord_%lld.txt", msec);
+static inline uint64_t PrefixXor(uint64_t bits)
+{
+    // bit n = xor of bits 0..n, turns quote positions into string ranges
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
 
-        FILE *f = fopen(filename, "wb");
-        fprintf(f, "error message: %s\n", message);
-        fprintf(f, "error index: %zu\n", ctx.i);
-        fprintf(f, "%.*s", (int)ctx.bufsize, ctx.buf);
-        fclose(f);
-        
-        // force to end then bail out of here
-        Assert(false);
-        ctx.error = true;
-        ctx.i = ctx.bufsize;
-    };
+static inline void AppendBitPositions(uint64_t bits, size_t base, Vector<uint32_t> &out)
+{
+    if (bits == 0)
+        return;
 
-    RecordAtom result = {};
-    size_t string_start_idx = 0;
-    size_t aggregate_start_idx = 0;
+    size_t out_idx = out.size();
+    out.resize(out_idx + __builtin_popcountll(bits));
+    uint32_t *dest = &out[out_idx];
+    while (bits != 0)
+    {
+        *dest++ = (uint32_t)(base + __builtin_ctzll(bits));
+        bits &= bits - 1;
+    }
+}
 
-    for (; ctx.i < ctx.bufsize; ctx.i++)
+static void IndexRecord(const char *buf, size_t begin, size_t end, 
+                        bool is_evaluation, Vector<uint32_t> &out)
+{
+    // positions of the chars the parsers act on, for records that's
+    // quotes and the structural chars outside of strings
+    out.clear();
+
+    uint64_t prev_escaped = 0;
+    uint64_t prev_in_string = 0;    // all ones when a string carries over
+    for (size_t block_idx = begin; block_idx < end; block_idx += 64)
     {
-        char c = ctx.buf[ ctx.i ];
+        // pad the tail out with spaces, they don't match anything
+        char tail[64];
+        const char *block = buf + block_idx;
+        size_t count = end - block_idx;
+        if (count < 64)
+        {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, count);
+            block = tail;
+        }
 
-        // skip over chars outside of string
-        if (result.type != Atom_String && (c == ' ' || c == ',' || c == ';' || c == '_' || c == '\n') ) 
-            continue;
+        BlockMasks masks;
+        ClassifyBlock(block, masks);
 
-        switch (result.type)
+        if (is_evaluation)
         {
-            case Atom_None:
-            {
-                // figure out what kind of block this is 
-                AtomType start = InferAtomStart(c);
-                if (start == Atom_String)
-                {
-                    // start after " index
-                    string_start_idx = ctx.i + 1;
-                }
-                else if (start == Atom_Name)
-                {
-                    string_start_idx = ctx.i;
-                }
-                else if (start == Atom_Array || start == Atom_Struct)
-                {
-                    // store the start of the aggregates
-                    aggregate_start_idx = ctx.atom_idx;
-                }
-                else if (start == Atom_None)
-                {
-                    RecurseError("can't deduce block type", c);
-                    continue;
-                }
+            AppendBitPositions(masks.eval, block_idx, out);
+        }
+        else
+        {
+            // quotes that aren't escaped open and close strings, structural
+            // chars only count outside of them. the opening quote is inside
+            // the string range and the closing one outside
+            uint64_t escaped = (masks.backslash == 0 && prev_escaped == 0)
+                ? 0 : FindEscapedChars(masks.backslash, prev_escaped);
+            uint64_t quote = masks.quote & ~escaped;
+            uint64_t in_string = PrefixXor(quote) ^ prev_in_string;
+            prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+            AppendBitPositions((masks.structural & ~in_string) | quote, 
+                               block_idx, out);
+        }
+    }
+}
+
+static bool IsRecordSkipChar(char c)
+{
+    return (c == ' ' || c == ',' || c == ';' || c == '_' || c == '\n');
+}
 
-                result.type = start;
+static RecordAtom ParseRecordAtoms(ParseRecordContext &ctx)
+{
+    // walk the structural chars of the record, text in between them is 
+    // either a name before '=' or skipped chars. open aggregates go on the
+    // frame stack, starting with the root
+    RecordAtom result = {};
+    bool done = false;
+    bool has_name = false;
+    Span name = {};
+    size_t gap_start = ctx.i;
+    ctx.frames.clear();
+
+    IndexRecord(ctx.buf, ctx.i, ctx.bufsize, false, ctx.index);
+    for (size_t k = 0; k < ctx.index.size() && !done; k++)
+    {
+        ctx.i = ctx.index[k];
+        char c = ctx.buf[ ctx.i ];
+        size_t gap_end = ctx.i;
+        size_t gap_idx = gap_start;
+        gap_start = ctx.i + 1;
 
-            } break;
+        while (gap_idx < gap_end && IsRecordSkipChar(ctx.buf[gap_idx]))
+            gap_idx++;
 
-            case Atom_Name:
+        if (c == '=')
+        {
+            for (size_t i = gap_idx; i < gap_end; i++)
             {
-                if (c == '=')
-                {
-                    // make the string, reset block state
-                    Assert(ctx.i >= string_start_idx);
-                    result.name.index = string_start_idx;
-                    result.name.length = ctx.i - string_start_idx;
-                    result.type = Atom_None;
-                }
-                else if (Atom_Name != InferAtomStart(c))
+                char n = ctx.buf[i];
+                if (Atom_Name != InferAtomStart(n) && !IsRecordSkipChar(n) &&
+                    !(n >= '0' && n <= '9'))
                 {
-                    RecurseError("hit bad atom name character", c);
-                    continue;
+                    SetParseError(ctx, "hit bad atom name character");
+                    break;
                 }
+            }
 
-            } break;
+            if (!ctx.error && (gap_idx == gap_end || has_name || ctx.frames.size() == 0))
+                SetParseError(ctx, "can't deduce block type");
 
-            case Atom_String:
-            {
-                // TODO: pointer previews of strings are messing this up
-                //       ex: value="0x555555556004 "%d""
-                char n = '\0';
-                char p = '\0';
-                if (ctx.i + 1 < ctx.bufsize)
-                    n = ctx.buf[ ctx.i + 1 ];
-                if (ctx.i >= 1)
-                    p = ctx.buf[ ctx.i - 1 ];
-
-                if (c == '"' && p != '\\' && (n == ',' || n == '}' || n == ']'))
-                {
-                    // hit closing quote
-                    // make the string, advance idx, return
-                    Assert(ctx.i >= string_start_idx);
-                    result.value.index = string_start_idx;
-                    result.value.length = ctx.i - string_start_idx;
-                    return result;
-                }
-            } break;
+            if (ctx.error)
+                break;
 
-            case Atom_Array:
-            case Atom_Struct:
-            {
-                AtomType start = InferAtomStart(c);
+            has_name = true;
+            name.index = gap_idx;
+            name.length = gap_end - gap_idx;
+            continue;
+        }
+        else if (gap_idx != gap_end)
+        {
+            SetParseError(ctx, "hit bad aggregate char");
+            break;
+        }
 
-                if (start != Atom_None)
-                {
-                    // start of new elem, recurse and add
-                    RecordAtom elem = RecurseRecord(ctx);
-                    PushUnorderedAtom(ctx, elem);
-                }
-                else if (c == ']' || c == '}')
-                {
-                    if ((c == ']' && result.type != Atom_Array) ||
-                        (c == '}' && result.type != Atom_Struct))
-                    {
-                        // hit wrong ending character
-                        char buf[128] = {};
-                        const char *type_str = (result.type == Atom_Array) ? "array" : "struct";
-                        tsnprintf(buf, "wrong ending character for %s", type_str);
-                        RecurseError(buf, c);
-                    }
-                    else
-                    {
-                        // end of aggregate, pop from unordered and store in gdb 
-                        RecordAtom pop = PopUnorderedAtom(ctx, aggregate_start_idx);
-                        result.value.index = pop.value.index;
-                        result.value.length = pop.value.length;
-                        return result;
-                    }
-                }
-                else
-                {
-                    RecurseError("hit bad aggregate char", c);
-                    continue;
-                }
+        RecordAtom atom = {};
+        if (has_name)
+        {
+            atom.name_index = name.index;
+            atom.name_length = name.length;
+        }
+
+        if (c == ',')
+        {
+            if (has_name)
+            {
+                SetParseError(ctx, "can't deduce block type");
+                break;
+            }
+            continue;
+        }
+        else if (c == '"')
+        {
+            // closing quote is always the next entry
+            if (k + 1 >= ctx.index.size())
+            {
+                SetParseError(ctx, "unterminated string");
+                break;
+            }
+
+            k++;
+            size_t close_idx = ctx.index[k];
+            Assert(ctx.buf[close_idx] == '"');
+            atom.type = Atom_String;
+            atom.value.index = ctx.i + 1;
+            atom.value.length = close_idx - (ctx.i + 1);
+            gap_start = close_idx + 1;
+        }
+        else if (c == '{' || c == '[')
+        {
+            ParseFrame add = {};
+            add.atom = atom;
+            add.atom.type = (c == '{') ? Atom_Struct : Atom_Array;
+            add.child_start_idx = ctx.pending.size();
+            ctx.frames.push_back(add);
+            has_name = false;
+            continue;
+        }
+        else // '}' ']'
+        {
+            if (has_name || ctx.frames.size() == 0)
+            {
+                SetParseError(ctx, "can't deduce block type");
+                break;
+            }
 
-            } break;
+            ParseFrame &frame = ctx.frames.back();
+            if ((c == ']' && frame.atom.type != Atom_Array) ||
+                (c == '}' && frame.atom.type != Atom_Struct))
+            {
+                SetParseError(ctx, (frame.atom.type == Atom_Array) 
+                              ? "wrong ending character for array"
+                              : "wrong ending character for struct");
+                break;
+            }
+
+            // end of aggregate, children go to the output in order
+            atom = frame.atom;
+            atom.value = PopChildAtoms(ctx, frame.child_start_idx);
+            ctx.frames.pop_back();
+        }
+
+        has_name = false;
+        if (ctx.frames.size() == 0)
+        {
+            result = atom;
+            done = true;
+        }
+        else
+        {
+            PushChildAtom(ctx, atom);
         }
     }
 
+    if (!ctx.error && !done)
+        SetParseError(ctx, "unterminated record");
+
     return result;
 }
 
+static void SkipToEvaluationIndex(ParseRecordContext &ctx)
+{
+    // cursor only moves forward, except when the parser steps back a char
+    while (ctx.index_pos > 0 && ctx.index[ ctx.index_pos - 1 ] >= ctx.i)
+        ctx.index_pos--;
+    while (ctx.index_pos < ctx.index.size() && ctx.index[ ctx.index_pos ] < ctx.i)
+        ctx.index_pos++;
+
+    size_t next = (ctx.index_pos < ctx.index.size()) 
+        ? ctx.index[ ctx.index_pos ] 
+        : ctx.bufsize;
+    if (next >= 2 && next - 2 > ctx.i)
+        ctx.i = next - 2;
+}
+
 RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
 {
     // parse the atom of a -data-evaluate-expression
@@ -624,6 +1221,13 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
 
     for (; ctx.i < ctx.bufsize; ctx.i++)
     {
+        if (inside_string_literal || atom.type == Atom_Name || atom.type == Atom_String)
+        {
+            // nothing happens in these states until we're 2 chars before
+            // one of the indexed chars, jump ahead to it
+            SkipToEvaluationIndex(ctx);
+        }
+
         char c = ctx.buf[ ctx.i ];
         char p = (ctx.i > 1) ? ctx.buf[ ctx.i - 1 ] : '\0';
         char pp = (ctx.i > 2) ? ctx.buf[ ctx.i - 2 ] : '\0';
@@ -664,7 +1268,7 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
             else if (c == '{')
             {
                 // store the start of the aggregates
-                aggregate_start_idx = ctx.atom_idx;
+                aggregate_start_idx = ctx.pending.size();
                 atom.type = Atom_Struct;
             }
             else
@@ -673,7 +1277,7 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
                 if ((n == ',' || n == '}' || nn == '<') && ctx.i > 0) 
                     ctx.i--; // single digit elements like {0, 1, 2}
 
-                if (atom.name.length == 0)
+                if (atom.name_length == 0)
                 {
                     atom.type = Atom_Name;
                 }
@@ -691,8 +1295,8 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
             {
                 // name = value, -1 to step back to space index
                 Assert(ctx.i - 1 >= string_start_idx);
-                atom.name.index = string_start_idx;
-                atom.name.length = (ctx.i - 1) - string_start_idx;
+                atom.name_index = string_start_idx;
+                atom.name_length = (ctx.i - 1) - string_start_idx;
                 atom.type = Atom_None;
             }
             else if (n == ',' || n == '}')
@@ -723,10 +1327,8 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
         {
             if (c == '}')
             {
-                // end of aggregate, pop from unordered and store in gdb 
-                RecordAtom pop = PopUnorderedAtom(ctx, aggregate_start_idx);
-                atom.value.index = pop.value.index;
-                atom.value.length = pop.value.length;
+                // end of aggregate, children go to the output in order
+                atom.value = PopChildAtoms(ctx, aggregate_start_idx);
 
                 if (EvaluateRunLength(rle_last_idx, rle_num_repeat))
                 {
@@ -739,23 +1341,22 @@ RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx)
             else
             {
                 // start of new elem, recurse and add
-                size_t saved_num_end_atoms = ctx.num_end_atoms;
+                size_t saved_num_atoms = ctx.atoms.size();
                 RecordAtomSequence elem = GDB_RecurseEvaluation(ctx);
-                if (elem.atom.name.length == 0)
+                if (elem.atom.name_length == 0)
                     atom.type = Atom_Array;
 
                 if (num_children < AGGREGATE_MAX)
                 {
                     size_t addcount = GetMin(elem.length, AGGREGATE_MAX - num_children);
                     for (size_t i = 0; i < addcount; i++)
-                        PushUnorderedAtom(ctx, elem.atom);
+                        PushChildAtom(ctx, elem.atom);
                     num_children += addcount;
                 }
                 else
                 {
-                    // no atoms added, remove any child in order pushes
-                    // to the end of the array
-                    ctx.num_end_atoms = saved_num_end_atoms;
+                    // no atoms added, remove any children it wrote out
+                    ctx.atoms.resize(saved_num_atoms);
                 }
             }
         } break;
@@ -779,16 +1380,17 @@ void GDB_PrintRecordAtom(const Record &rec, const RecordAtom &iter,
     {
         case Atom_String:  // key value pair
         {
+            StringView value = GetAtomView(iter, rec);
             fprintf(out, "%.*s=\"%.*s\"\n",
-                    int(iter.name.length), &rec.buf[ iter.name.index ],
-                    int(iter.value.length), &rec.buf[ iter.value.index ]);
+                    int(iter.name_length), &rec.buf[ iter.name_index ],
+                    int(value.size), value.data);
         } break;
 
         case Atom_Struct:
         case Atom_Array:
         {
-            fprintf(out, "%.*s\n", int(iter.name.length), 
-                    &rec.buf[ iter.name.index ]);
+            fprintf(out, "%.*s\n", int(iter.name_length), 
+                    &rec.buf[ iter.name_index ]);
 
             for (const RecordAtom &child : GDB_IterChild(rec, &iter))
             {
@@ -801,105 +1403,243 @@ void GDB_PrintRecordAtom(const Record &rec, const RecordAtom &iter,
     }
 }
 
-const RecordAtom *GDB_ExtractAtom(const char *name, size_t namelen, 
-                                  size_t name_idx, const RecordAtom &iter,
-                                  const Record &rec)
+void GDB_UnescapeRecord(Record &rec)
 {
-    // copy segment of full name to temp buffer
-    char temp[256] = {};
-    const char *dotpos = strchr(name + name_idx, '.');
-    size_t end_idx = (dotpos != NULL) ? dotpos - name : namelen;
-    memcpy(temp, name + name_idx, end_idx - name_idx);
-
-    unsigned long long index = ~0;
-    char *bracket;
-    if ( (bracket = strchr(temp, '[')) )
+    // one forward pass over the values the parser marked, the resolved
+    // text is never longer so it stays inside the atom's span
+    for (RecordAtom &atom : rec.atoms)
     {
-        int num_found = sscanf(bracket, "[%llu]", &index);
-        if (num_found != 1)
-        {
-            PrintError("sscanf error\n");
-        }
-        else
+        if (atom.type != Atom_String || !atom.has_escapes)
+            continue;
+
+        char *text = &rec.buf[ atom.value.index ];
+        size_t length = atom.value.length;
+        size_t out = 0;
+        for (size_t i = 0; i < length; i++)
         {
-            size_t bracket_offset = bracket - temp;
-            memset(bracket, '\0', sizeof(temp) - bracket_offset);
+            char c = text[i];
+            if (c == '\\' && i + 1 < length && (text[i + 1] == '\\' || text[i + 1] == '\"'))
+                c = text[++i];
+
+            text[out++] = c;
         }
+
+        atom.value.length = out;
+        atom.has_escapes = false;
     }
-    size_t tempsize = strlen(temp);
+}
 
-    for (const RecordAtom &child : GDB_IterChild(rec, &iter))
+static void MarkEscapedStrings(ParseRecordContext &ctx)
+{
+    for (RecordAtom &atom : ctx.atoms)
     {
-        if (index < child.value.length && child.type == Atom_Array)
+        if (atom.type == Atom_String)
         {
-            // array[] syntax, select n'th child
-            const RecordAtom *child_base = 
-                &rec.atoms[ child.value.index ];
-            return GDB_ExtractAtom(name, namelen, end_idx + 1,
-                                   child_base[index], rec);
+            atom.has_escapes = (NULL != memchr(ctx.buf + atom.value.index, '\\', 
+                                               atom.value.length));
         }
-        else if (child.name.length == tempsize &&
-                 0 == memcmp(temp, &rec.buf[ child.name.index ], tempsize))
+    }
+}
+
+// parents with fewer children are faster to walk than to probe, most
+// records are tuples of a handful of fields
+#define CHILD_INDEX_MIN_CHILDREN 8
+
+// slot of a child name, a parent's children are one span of atoms
+// so the span start stands in for the parent
+static uint32_t ChildNameSlot(uint32_t name_hash, uint32_t first_child, uint32_t mask)
+{
+    return (name_hash ^ (first_child * 2654435761u)) & mask;
+}
+
+static bool IsIndexedParent(const RecordAtom &parent)
+{
+    return (parent.type == Atom_Struct || parent.type == Atom_Array) &&
+           parent.value.length >= CHILD_INDEX_MIN_CHILDREN;
+}
+
+void GDB_HashRecordNames(Record &rec)
+{
+    size_t num_indexed = 0;
+    rec.name_hashes.resize(rec.atoms.size());
+    for (size_t i = 0; i < rec.atoms.size(); i++)
+    {
+        const RecordAtom &atom = rec.atoms[i];
+        rec.name_hashes[i] = HashAtomName(&rec.buf[ atom.name_index ], atom.name_length);
+        if (IsIndexedParent(atom))
+            num_indexed += atom.value.length;
+    }
+
+    rec.name_slots.clear();
+    if (num_indexed == 0)
+        return;
+
+    // at most half full, only the first of duplicate names gets a slot
+    // (frame= in a stack) since lookups return the first match anyway
+    size_t num_slots = 16;
+    while (num_slots < num_indexed * 2)
+        num_slots *= 2;
+
+    uint32_t mask = (uint32_t)(num_slots - 1);
+    rec.name_slots.resize(num_slots, 0);
+    for (const RecordAtom &parent : rec.atoms)
+    {
+        if (!IsIndexedParent(parent))
+            continue;
+
+        for (uint32_t i = parent.value.index; i < parent.value.index + parent.value.length; i++)
         {
-            if (end_idx == namelen)
-            {
-                // found the target
-                return &child;
-            }
-            else
+            const RecordAtom &child = rec.atoms[i];
+            if (child.name_length == 0)
+                continue;
+
+            uint32_t slot = ChildNameSlot(rec.name_hashes[i], parent.value.index, mask);
+            bool is_duplicate = false;
+            while (rec.name_slots[slot] != 0 && !is_duplicate)
             {
-                return GDB_ExtractAtom(name, namelen, end_idx + 1, child, rec);
+                uint32_t prev_idx = rec.name_slots[slot] - 1;
+                const RecordAtom &prev = rec.atoms[prev_idx];
+                is_duplicate = (prev_idx >= parent.value.index &&
+                                rec.name_hashes[prev_idx] == rec.name_hashes[i] &&
+                                prev.name_length == child.name_length &&
+                                0 == memcmp(&rec.buf[ prev.name_index ], 
+                                            &rec.buf[ child.name_index ], child.name_length));
+                slot = (slot + 1) & mask;
             }
+
+            if (!is_duplicate)
+                rec.name_slots[slot] = i + 1;
         }
     }
+}
+
+static const RecordAtom *SelectChildAtom(const AtomPathSegment &segment, 
+                                         const RecordAtom &child, const Record &rec)
+{
+    if (segment.array_index == ATOM_NO_ARRAY_INDEX)
+        return &child;
+
+    // array[] syntax, select n'th child
+    if (child.type == Atom_Array && segment.array_index < child.value.length)
+        return &rec.atoms[ child.value.index + segment.array_index ];
+
     return NULL;
 }
 
-String GDB_ExtractValue(const char *keyname, const RecordAtom &root, const Record &rec)
+static const RecordAtom *FindChildAtom(const AtomPath &path, const AtomPathSegment &segment,
+                                       const RecordAtom &parent, const Record &rec)
 {
-    String result = "";
-    const RecordAtom *target = GDB_ExtractAtom(keyname, strlen(keyname), 0, root, rec);
-    if (target)
+    // records built by hand have no hashes, compare every name
+    const uint32_t *hashes = (rec.name_hashes.size() == rec.atoms.size())
+        ? rec.name_hashes.data() 
+        : NULL;
+    const char *name = path.text + segment.index;
+
+    if (hashes != NULL && rec.name_slots.size() != 0 && IsIndexedParent(parent))
     {
-        Assert(target->type == Atom_String);
-        result = GetAtomString(target->value, rec);
+        // probe the (parent, name) table, a slot can hold a child of any parent
+        uint32_t first = parent.value.index;
+        uint32_t end = first + parent.value.length;
+        uint32_t mask = (uint32_t)(rec.name_slots.size() - 1);
+        for (uint32_t slot = ChildNameSlot(segment.hash, first, mask); 
+             rec.name_slots[slot] != 0; 
+             slot = (slot + 1) & mask)
+        {
+            uint32_t child_idx = rec.name_slots[slot] - 1;
+            const RecordAtom &child = rec.atoms[child_idx];
+            if (child_idx >= first && child_idx < end &&
+                hashes[child_idx] == segment.hash &&
+                child.name_length == segment.length &&
+                0 == memcmp(name, &rec.buf[ child.name_index ], segment.length))
+            {
+                return SelectChildAtom(segment, child, rec);
+            }
+        }
+
+        return NULL;
     }
-    return result;
+
+    // small parents, hashes rule out most of the names without touching the record text
+    for (const RecordAtom &child : GDB_IterChild(rec, &parent))
+    {
+        size_t child_idx = &child - rec.atoms.data();
+        if ( (hashes == NULL || hashes[child_idx] == segment.hash) &&
+             child.name_length == segment.length &&
+             0 == memcmp(name, &rec.buf[ child.name_index ], segment.length) )
+        {
+            return SelectChildAtom(segment, child, rec);
+        }
+    }
+
+    return NULL;
 }
 
-int GDB_ExtractInt(const char *name, const RecordAtom &root, const Record &rec)
+const RecordAtom *GDB_ExtractAtom(const AtomPath &path, const RecordAtom &root,
+                                  const Record &rec)
 {
-    int result = 0;
-    const RecordAtom *target = GDB_ExtractAtom(name, strlen(name), 0, root, rec);
+    Assert(path.num_segments <= ATOM_PATH_MAX);
+    const RecordAtom *result = (path.num_segments <= ATOM_PATH_MAX) ? &root : NULL;
+    for (size_t i = 0; i < path.num_segments && result != NULL; i++)
+        result = FindChildAtom(path, path.segments[i], *result, rec);
+
+    return (result != &root) ? result : NULL;
+}
+
+StringView GDB_ExtractView(const AtomPath &path, const RecordAtom &root, const Record &rec)
+{
+    StringView result = {};
+    const RecordAtom *target = GDB_ExtractAtom(path, root, rec);
     if (target)
     {
         Assert(target->type == Atom_String);
-        result = atoi( GDB_ExtractValue(name, root, rec).c_str() );
+        result = GetAtomView(*target, rec);
     }
     return result;
 }
 
-const RecordAtom *GDB_ExtractAtom(const char *name, const RecordAtom &root,
-                                  const Record &rec)
+String GDB_ExtractValue(const AtomPath &path, const RecordAtom &root, const Record &rec)
 {
-    const RecordAtom *result = GDB_ExtractAtom(name, strlen(name), 0, root, rec);
-    return result;
+    return ToString( GDB_ExtractView(path, root, rec) );
+}
+
+int GDB_ExtractInt(const AtomPath &path, const RecordAtom &root, const Record &rec)
+{
+    // same as atoi, without needing a null terminated copy
+    StringView view = GDB_ExtractView(path, root, rec);
+    size_t i = 0;
+    while (i < view.size && view.data[i] == ' ')
+        i++;
+
+    bool negative = (i < view.size && view.data[i] == '-');
+    if (i < view.size && (view.data[i] == '-' || view.data[i] == '+'))
+        i++;
+
+    int result = 0;
+    for (; i < view.size && view.data[i] >= '0' && view.data[i] <= '9'; i++)
+        result = (result * 10) + (view.data[i] - '0');
+
+    return (negative) ? -result : result;
 }
 
 // 
 // helper functions
 //
-String GDB_ExtractValue(const char *name, const Record &rec)
+StringView GDB_ExtractView(const AtomPath &path, const Record &rec)
+{
+    StringView empty = {};
+    return (rec.atoms.size() == 0) ? empty : GDB_ExtractView(path, rec.atoms[0], rec);
+}
+String GDB_ExtractValue(const AtomPath &path, const Record &rec)
 {
-    return (rec.atoms.size() == 0) ? "" : GDB_ExtractValue(name, rec.atoms[0], rec);
+    return (rec.atoms.size() == 0) ? "" : GDB_ExtractValue(path, rec.atoms[0], rec);
 }
-int GDB_ExtractInt(const char *name, const Record &rec)
+int GDB_ExtractInt(const AtomPath &path, const Record &rec)
 {
-    return (rec.atoms.size() == 0) ? 0 : GDB_ExtractInt(name, rec.atoms[0], rec);
+    return (rec.atoms.size() == 0) ? 0 : GDB_ExtractInt(path, rec.atoms[0], rec);
 }
-const RecordAtom *GDB_ExtractAtom(const char *name, const Record &rec)
+const RecordAtom *GDB_ExtractAtom(const AtomPath &path, const Record &rec)
 {
-    return (rec.atoms.size() == 0) ? NULL : GDB_ExtractAtom(name, rec.atoms[0], rec);
+    return (rec.atoms.size() == 0) ? NULL : GDB_ExtractAtom(path, rec.atoms[0], rec);
 }
 
 void IterateAtoms(Record &rec, RecordAtom &iter, AtomIterator *iterator, void *ctx)
@@ -916,18 +1656,34 @@ void IterateAtoms(Record &rec, RecordAtom &iter, AtomIterator *iterator, void *c
     }
 }
 
-bool GDB_ParseRecord(char *buf, size_t bufsize, ParseRecordContext &ctx)
+static void ResetParseContext(ParseRecordContext &ctx, const char *buf, size_t bufsize)
 {
-    // parse async/sync record
-    ctx = {};
+    // keep the vector capacity around for the next record
+    ctx.atoms.clear();
+    ctx.atoms.resize(1);    // root
+    ctx.pending.clear();
+    ctx.frames.clear();
+    ctx.index.clear();
+    ctx.index_pos = 0;
+    ctx.error = false;
+    ctx.error_message = NULL;
+    ctx.error_idx = 0;
+    ctx.i = 0;
     ctx.buf = buf;
     ctx.bufsize = bufsize;
+}
+
+bool GDB_ParseRecord(char *buf, size_t bufsize, ParseRecordContext &ctx)
+{
+    TRACE_SCOPE(trace, "GDB_ParseRecord");
+    trace.bytes = bufsize;
+
+    // parse async/sync record
+    ResetParseContext(ctx, buf, bufsize);
 
     // get the record keyword, immediately after type prefix
     char *comma = (char *)memchr(buf, ',', bufsize);
-    RecordAtom root = {};
-
-    if (comma)
+    if (comma != NULL && comma + 1 < buf + bufsize)
     {
         ctx.i = comma - buf;
 
@@ -939,65 +1695,42 @@ bool GDB_ParseRecord(char *buf, size_t bufsize, ParseRecordContext &ctx)
         *comma = '[';
         *last = ']';
 
-        // scan the buffer to the the total amount of atoms
-        size_t num_atoms_found = 0;
-        for (size_t i = 0; i < ctx.bufsize; i++)
-        {
-            char n = (i + 1 < ctx.bufsize) ? ctx.buf[i + 1] : '\0';
-            char c = ctx.buf[i];
-            if ((c == '[' || c == '{') || 
-                (c == '=' && n == '"') || 
-                (c == '"' && n == ',') )
-                num_atoms_found++;
-        }
-
-        // total=(name+value atoms) * num atoms
-        ctx.atoms.resize(num_atoms_found * 2);
-
-        root = RecurseRecord(ctx);
+        // output grows while parsing, don't hold a reference into it
+        RecordAtom root = ParseRecordAtoms(ctx);
+        ctx.atoms[0] = root;
 
         // restore the modified chars
         *comma = prev_comma;
-        *last = prev_eol;    // @@@ case where no comma is found problem
+        *last = prev_eol;
 
+        MarkEscapedStrings(ctx);
+
+        if (ctx.error)
+        {
+            // records can be hundreds of MB, only show the chars around the error
+            size_t first = (ctx.error_idx > PARSE_ERROR_CONTEXT) ? ctx.error_idx - PARSE_ERROR_CONTEXT : 0;
+            size_t end = GetMin(ctx.error_idx + PARSE_ERROR_CONTEXT, bufsize);
+            fprintf(stderr, "parse record error: %s at index %zu of %zu\n   %.*s\n",
+                    ctx.error_message, ctx.error_idx, bufsize, (int)(end - first), buf + first);
+        }
     }
     else
     {
-        // this is a prefix-one word record i.e. ^done
-        ctx.error = false;
-        ctx.atoms.resize(1);    // root
+        // prefix-one word record i.e. ^done or ^done, with nothing after it,
+        // the root is an array without children
+        ctx.atoms[0].type = Atom_Array;
     }
 
-    if (!ctx.error)
-    {
-        // put the root in place since it doesn't get popped to the 
-        // ordered section of the array
-        ctx.num_end_atoms++;
-
-        // atoms are in order at the end of the array,
-        // subtract the difference from base ordered
-        Assert(ctx.num_end_atoms <= ctx.atoms.size());
-        size_t ordered_offset = ctx.atoms.size() - ctx.num_end_atoms;
-        RecordAtom *ordered_base = &ctx.atoms[ ordered_offset ];
-        ordered_base[0] = root;
-
-        for (size_t i = 0; i < ctx.num_end_atoms; i++)
-        {
-            RecordAtom *iter = &ordered_base[i];
-            if ( (iter->type == Atom_Array || iter->type == Atom_Struct) &&
-                 (iter->value.length != 0))
-            {
-                // adjust aggregate offset
-                Assert(iter->value.index > ordered_offset);
-                iter->value.index -= ordered_offset;
-            }
-        }
-
-        // num_end_atoms = num atoms
-        auto begin = ctx.atoms.begin();
-        ctx.atoms.erase(begin, begin + ctx.atoms.size() - ctx.num_end_atoms);
-    }
+    return !ctx.error;
+}
 
+bool GDB_ParseEvaluation(const char *buf, size_t bufsize, ParseRecordContext &ctx)
+{
+    ResetParseContext(ctx, buf, bufsize);
+    IndexRecord(buf, 0, bufsize, true, ctx.index);
+    RecordAtom root = GDB_RecurseEvaluation(ctx).atom;
+    ctx.atoms[0] = root;
+    MarkEscapedStrings(ctx);
     return !ctx.error;
 }
 
@@ -1037,6 +1770,13 @@ bool GDB_Send(const char *cmd)
             }
             else
             {
+                if (gdb.transcript)
+                {
+                    String sent = cmd;
+                    sent += '\n';
+                    RecordTraffic(TRANSCRIPT_TO_GDB, sent.data(), sent.size());
+                }
+
                 result = true;
             }
         }
@@ -1045,72 +1785,214 @@ bool GDB_Send(const char *cmd)
     return result;
 }
 
+static int GetCommandTimeout(const char *cmd)
+{
+    // commands that load or walk the symbol tables can take a lot
+    // longer than the default on big executables
+    static const struct { const char *prefix; int timeout_ms; } SLOW_COMMANDS[] =
+    {
+        { "-file-exec-and-symbols",         60 * 1000 },
+        { "-file-symbol-file",              60 * 1000 },
+        { "-file-list-exec-source-files",   30 * 1000 },
+        { "-symbol-info-",                  30 * 1000 },
+        { "-target-attach",                 30 * 1000 },
+        { "-exec-run",                      30 * 1000 },
+    };
+
+    int result = gdb.command_timeout_ms;
+    for (size_t i = 0; i < ArrayCount(SLOW_COMMANDS); i++)
+    {
+        const char *prefix = SLOW_COMMANDS[i].prefix;
+        if (0 == strncmp(cmd, prefix, strlen(prefix)))
+        {
+            result = GetMax(result, SLOW_COMMANDS[i].timeout_ms);
+            break;
+        }
+    }
+
+    return result;
+}
+
+// sent_cmds gets trimmed back to this many once it's twice as big
+#define SENT_COMMANDS_KEEP 4096
+
+static void LogSentCommand(uint32_t id, const char *cmd)
+{
+    SentCommand add = {};
+    add.id = id;
+    add.text = cmd;
+    add.send_ns = GetNanoseconds();
+    if (gdb.traffic_start_ns == 0)
+        gdb.traffic_start_ns = add.send_ns;
+
+    // totals by MI operation, a session only uses a few dozen of them
+    size_t verblen = strcspn(cmd, " ");
+    add.stats_idx = BAD_INDEX;
+    for (size_t i = 0; i < gdb.command_stats.size(); i++)
+    {
+        const String &verb = gdb.command_stats[i].verb;
+        if (verb.size() == verblen && 0 == memcmp(verb.data(), cmd, verblen))
+        {
+            add.stats_idx = i;
+            break;
+        }
+    }
+
+    if (add.stats_idx == BAD_INDEX)
+    {
+        add.stats_idx = gdb.command_stats.size();
+        CommandStats stats = {};
+        stats.verb.assign(cmd, verblen);
+        gdb.command_stats.push_back(stats);
+    }
+
+    gdb.command_stats[add.stats_idx].count++;
+
+    if (gdb.sent_cmds.size() >= 2 * SENT_COMMANDS_KEEP)
+    {
+        gdb.sent_cmds.erase(gdb.sent_cmds.begin(), 
+                            gdb.sent_cmds.end() - SENT_COMMANDS_KEEP);
+    }
+
+    gdb.sent_cmds.push_back(add);
+}
+
+static SentCommand *FindSentCommand(uint32_t id)
+{
+    // replies come back close to the end, search newest first
+    for (size_t i = gdb.sent_cmds.size(); i > 0; i--)
+    {
+        SentCommand &iter = gdb.sent_cmds[i - 1];
+        if (iter.id == id)
+            return &iter;
+    }
+
+    return NULL;
+}
+
+static void LogCommandReply(const Record &rec, uint64_t read_ns)
+{
+    SentCommand *sent = FindSentCommand(rec.id);
+    if (sent == NULL || sent->reply_ns != 0)
+        return;
+
+    sent->reply_ns = GetMax(read_ns, sent->send_ns);
+    sent->reply_bytes = rec.buf.size();
+    sent->reply_atoms = rec.atoms.size();
+    sent->error = (rec.action == Action_Error);
+
+    uint64_t latency_ns = sent->reply_ns - sent->send_ns;
+    CommandStats &stats = gdb.command_stats[ sent->stats_idx ];
+    stats.num_replies++;
+    stats.num_errors += (sent->error) ? 1 : 0;
+    stats.total_bytes += sent->reply_bytes;
+    stats.total_latency_ns += latency_ns;
+    stats.max_latency_ns = GetMax(stats.max_latency_ns, latency_ns);
+}
+
+static void LogCommandTimeout(uint32_t id)
+{
+    SentCommand *sent = FindSentCommand(id);
+    if (sent != NULL && !sent->timed_out)
+    {
+        sent->timed_out = true;
+        gdb.command_stats[ sent->stats_idx ].num_timeouts++;
+    }
+}
+
+static size_t GetCommandTraceStat(const char *kind, const char *cmd)
+{
+    // one stat per MI operation, the arguments would make every send unique
+    if (!IsTraceEnabled())
+        return TRACE_STAT_INVALID;
+
+    size_t oplen = strcspn(cmd, " ");
+    char name[64];
+    int namelen = snprintf(name, sizeof(name), "%s %.*s", kind, (int)oplen, cmd);
+    return TraceGetStat(name, GetMin((size_t)namelen, sizeof(name) - 1));
+}
+
 static size_t GDB_SendBlockingInternal(const char *cmd, bool remove_after)
 {
+    TraceScope trace(GetCommandTraceStat("send", cmd));
+
     uint32_t this_record_id = gdb.record_id++;
     char fullrecord[8 * 1024];
     tsnprintf(fullrecord, "%u%s", this_record_id, cmd);
     size_t result = BAD_INDEX;
 
+    // register before sending so the reader thread can't miss the result
+    PendingCommand &pending = gdb.pending[ this_record_id % ArrayCount(gdb.pending) ];
+    Assert(pending.id == 0);
+    pthread_mutex_lock(&gdb.pending_lock);
+    pending.id = this_record_id;
+    pending.completed = false;
+    pending.wake = false;
+    pthread_mutex_unlock(&gdb.pending_lock);
+    pending.rec_idx = BAD_INDEX;
+
     if (GDB_Send(fullrecord))
     {
-        bool found = false;
-        do
+        LogSentCommand(this_record_id, cmd);
+
+        timeval now = {};
+        gettimeofday(&now, NULL);
+        int timeout_ms = GetCommandTimeout(cmd);
+        long long nsec = (long long)now.tv_usec * 1000 + (long long)(timeout_ms % 1000) * 1000000;
+        timespec deadline = {};
+        deadline.tv_sec = now.tv_sec + (timeout_ms / 1000) + (nsec / 1000000000);
+        deadline.tv_nsec = nsec % 1000000000;
+
+        bool completed = false;
+        while (true)
         {
-            timeval tmp = {};
-            timespec wait_for = {};
-            if (0 == gettimeofday(&tmp, NULL))
-            {
-                wait_for.tv_sec = tmp.tv_sec + 1;
-                wait_for.tv_nsec = tmp.tv_usec * 1000;
-            }
-
-            int rc = sem_timedwait(gdb.recv_block, &wait_for);
-            if (rc < 0)
+            // the result record gets matched up to this slot when it's taken out of the ring
+            GDB_GrabBlockData();
+            if (pending.rec_idx < prog.num_recs)
             {
-                if (errno == ETIMEDOUT)
+                RecordHolder &iter = prog.read_recs[ pending.rec_idx ];
+                if (iter.rec.action == Action_Error)
                 {
-                    // TODO: retry counts
-                    PrintErrorf("Command Timeout %s\n", cmd);
+                    iter.parsed = true;
+                    result = BAD_INDEX;
                 }
                 else
                 {
-                    PrintErrorf("sem_timedwait %s\n", GetErrorString(errno));
+                    iter.parsed = remove_after;
+                    result = pending.rec_idx;
                 }
 
                 break;
             }
-            else
+            else if (completed)
             {
-                GDB_GrabBlockData();
-
-                // scan the lines for a result record, mark it as read
-                // to prevent later processing
-                for (size_t i = 0; i < prog.num_recs; i++)
-                {
-                    RecordHolder &iter = prog.read_recs[i];
-                    if (!iter.parsed && iter.rec.id == this_record_id)
-                    {
-                        if ("error" == GDB_GetRecordAction(iter.rec))
-                        {
-                            iter.parsed = true;
-                            result = BAD_INDEX;
-                        }
-                        else
-                        {
-                            iter.parsed = remove_after;
-                            result = i;
-                        }
-
-                        found = true;
-                        break;
-                    }
-                }
+                // result got published but couldn't be matched
+                break;
             }
 
-        } while (!found);
+            pthread_mutex_lock(&gdb.pending_lock);
+            int rc = 0;
+            while (!pending.completed && !pending.wake && rc != ETIMEDOUT)
+                rc = pthread_cond_timedwait(&pending.cond, &gdb.pending_lock, &deadline);
+
+            completed = pending.completed;
+            bool timed_out = (!pending.completed && !pending.wake);
+            pending.wake = false;
+            pthread_mutex_unlock(&gdb.pending_lock);
+
+            if (timed_out)
+            {
+                LogCommandTimeout(this_record_id);
+                PrintErrorf("Command Timeout %s\n", cmd);
+                break;
+            }
+        }
     }
 
+    pthread_mutex_lock(&gdb.pending_lock);
+    pending.id = 0;
+    pthread_mutex_unlock(&gdb.pending_lock);
+
     // reset to default ignoring "no symbol in context" GDB MI error
     gdb.echo_next_no_symbol_in_context = false;
 
@@ -1144,152 +2026,339 @@ bool GDB_SendBlocking(const char *cmd, Record &rec)
     return result;
 }
 
-static void GDB_ProcessBlock(char *block, size_t blocksize)
+bool GDB_SendAsync(const char *cmd, AsyncCallback callback)
 {
-    // parse buffer of interpreter lines ending in (gdb)
-    // sync/async records get stored 
-    // console/debug logs get written to log_lines
-    size_t block_idx = 0;
-    while (block_idx < blocksize)
+    uint32_t this_record_id = gdb.record_id++;
+    char fullrecord[8 * 1024];
+    tsnprintf(fullrecord, "%u%s", this_record_id, cmd);
+
+    bool result = GDB_Send(fullrecord);
+    if (result)
     {
-        // parse the optional id preceding the record
-        uint32_t this_record_id = 0;
-        while (block_idx < blocksize)
-        {
-            char c = block[ block_idx ];
-            if (c >= '0' && c <= '9')
-            {
-                this_record_id *= 10;
-                this_record_id += (c - '0');
-                block_idx++;
-            }
-            else
-            {
-                break;
-            }
-        }
+        LogSentCommand(this_record_id, cmd);
+
+        AsyncCommand add = {};
+        add.id = this_record_id;
+        add.echo_no_symbol_in_context = gdb.echo_next_no_symbol_in_context;
+        add.callback = callback;
+        add.trace_stat = GetCommandTraceStat("async", cmd);
+        add.sent_ns = GetNanoseconds();
+        add.deadline_ns = add.sent_ns + (uint64_t)GetCommandTimeout(cmd) * 1000000;
+        gdb.async_cmds[this_record_id] = std::move(add);
+    }
 
-        char *start = block + block_idx;
-        char *eol = strchr(start, '\n');
-        if (eol)
-        {
-            if (eol[-1] == '\r')
-            {
-                eol[-1] = ' ';
-            }
-            eol[0] = ' ';
+    // reset to default ignoring "no symbol in context" GDB MI error
+    gdb.echo_next_no_symbol_in_context = false;
+
+    return result;
+}
+
+uint64_t GDB_DispatchAsync()
+{
+    for (size_t i = 0; i < prog.num_recs && gdb.async_cmds.size() > 0; i++)
+    {
+        RecordHolder &iter = prog.read_recs[i];
+        if (iter.parsed || iter.rec.id == 0)
+            continue;
+
+        auto cmd = gdb.async_cmds.find(iter.rec.id);
+        if (cmd == gdb.async_cmds.end())
+            continue;
 
-            eol++; // GDB_ParseRecord inserts a ']' at the end
+        // callbacks can send blocking commands that grow prog.read_recs,
+        // take everything out of the arrays before calling
+        AsyncCallback callback = std::move(cmd->second.callback);
+        size_t trace_stat = cmd->second.trace_stat;
+        uint64_t sent_ns = cmd->second.sent_ns;
+        gdb.async_cmds.erase(cmd);
+
+        Record rec;
+        std::swap(rec, iter.rec);
+        iter.parsed = true;
+
+        callback(rec, rec.action != Action_Error);
+
+        // round trip from sending through the callback finishing
+        if (trace_stat != TRACE_STAT_INVALID)
+            TraceRecord(trace_stat, sent_ns, GetNanoseconds() - sent_ns, rec.buf.size());
+
+        // hand the buffers back to the slot for the next record
+        if (i < prog.read_recs.size())
+            std::swap(rec, prog.read_recs[i].rec);
+    }
+
+    // results that never came, fail them the same as a blocking send
+    static Vector<uint32_t> expired;
+    expired.clear();
+    uint64_t now = GetNanoseconds();
+    uint64_t next_deadline_ns = 0;
+    for (const auto &iter : gdb.async_cmds)
+    {
+        const AsyncCommand &cmd = iter.second;
+        if (now >= cmd.deadline_ns)
+            expired.push_back(iter.first);
+        else if (next_deadline_ns == 0 || cmd.deadline_ns < next_deadline_ns)
+            next_deadline_ns = cmd.deadline_ns;
+    }
+
+    for (uint32_t id : expired)
+    {
+        auto cmd = gdb.async_cmds.find(id);
+        AsyncCallback callback = std::move(cmd->second.callback);
+        gdb.async_cmds.erase(cmd);
+
+        LogCommandTimeout(id);
+        SentCommand *sent = FindSentCommand(id);
+        PrintErrorf("Command Timeout %s\n", (sent != NULL) ? sent->text.c_str() : "");
+
+        Record rec;
+        callback(rec, false);
+    }
+
+    // callbacks can send more, those time out after everything still waiting
+    return next_deadline_ns;
+}
+
+void GDB_ParseLine(const char *line, size_t linesize, ParseRecordContext &ctx, RecordLine &out)
+{
+    // parse the optional id preceding the record
+    size_t idx = 0;
+    uint32_t this_record_id = 0;
+    for (; idx < linesize; idx++)
+    {
+        char c = line[idx];
+        if (c >= '0' && c <= '9')
+        {
+            this_record_id *= 10;
+            this_record_id += (c - '0');
         }
         else
         {
-            // all records should be NL terminated
-            Assert(false);
             break;
         }
+    }
+
+    out.is_record = false;
+    out.text.assign(line + idx, linesize - idx);
 
-        size_t linesize = eol - start;
-        bool is_prompt = (linesize >= 5 && (0 == memcmp(start, "(gdb)", 5)) );
-        if (!is_prompt)
-            WriteToConsoleBuffer(start, linesize);
+    // GDB_ParseRecord inserts a ']' at the last char
+    size_t textsize = out.text.size();
+    if (textsize > 0 && out.text[textsize - 1] == '\n')
+    {
+        if (textsize > 1 && out.text[textsize - 2] == '\r')
+            out.text[textsize - 2] = ' ';
+        out.text[textsize - 1] = ' ';
+    }
+    else
+    {
+        // all records should be NL terminated
+        Assert(false);
+    }
 
-        // get the record type
-        char prefix = start[0];
-        if (prefix == PREFIX_RESULT || prefix == PREFIX_ASYNC0 || prefix == PREFIX_ASYNC1) 
+    out.is_prompt = (textsize >= 5 && (0 == memcmp(out.text.data(), "(gdb)", 5)) );
+
+    // get the record type
+    char prefix = (textsize > 0) ? out.text[0] : '\0';
+    if (prefix == PREFIX_RESULT || prefix == PREFIX_ASYNC0 || prefix == PREFIX_ASYNC1) 
+    {
+        Record &rec = out.rec;
+        rec.buf = out.text;
+
+        // action ends at the first result or the converted newline
+        size_t action_end = 1;
+        while (action_end < textsize && out.text[action_end] != ',' && 
+               out.text[action_end] != ' ')
+            action_end++;
+        rec.action = GDB_ClassifyRecord(out.text.data() + 1, action_end - 1);
+        if ( GDB_ParseRecord(&rec.buf[0], rec.buf.size(), ctx) )
         {
-            static ParseRecordContext ctx;
-            if ( GDB_ParseRecord(start, linesize, ctx) )
-            {
-                if (prog.read_recs.size() < prog.num_recs + 1)
-                {
-                    size_t newcount = (prog.num_recs + 1) * 4;
-                    prog.read_recs.resize(newcount);
-                }
+            out.is_record = true;
+            rec.atoms = ctx.atoms;
+            rec.id = this_record_id;
 
-                RecordHolder &out = prog.read_recs[ prog.num_recs ];
-                out = {};
-                prog.num_recs++;
+            // still on the reader thread, readers only ever see a const record
+            GDB_UnescapeRecord(rec);
+            GDB_HashRecordNames(rec);
 
-                Record &rec = out.rec;
-                rec.atoms = ctx.atoms;
-                rec.buf.resize(linesize);
-                rec.id = this_record_id;
-                memcpy(const_cast<char*>(rec.buf.data()), start, linesize);
+            // @Debug
+            //GDB_PrintRecordAtom(rec, rec.atoms[0], 0);
+        }
+    }
+}
 
-                // resolve literal within strings
-                // ignore those of name "value" because these get handled in RecurseEvaluation
-                const auto RemoveStringBackslashes = [](Record &record, RecordAtom &iter, void * /* user context */)
-                {
-                    if (iter.type == Atom_String)
-                    {
-                        size_t new_length = iter.value.length;
-                        for (size_t i = 0; i < iter.value.length; i++)
-                        {
-                            size_t buf_idx = iter.value.index + i;
-                            char c = record.buf[buf_idx];
-                            char n = (i + 1 < iter.value.length) ? record.buf[buf_idx + 1] : '\0';
-                            if (c == '\\' && (n == '\\' || n == '\"'))
-                            {
-                                //record.buf[iter.value.index + new_length - 1] = ' ';
-                                memmove(&record.buf[buf_idx], &record.buf[buf_idx + 1], iter.value.length - (i + 1));
-                                new_length--;
-                            }
-                        }
-                        iter.value.length = new_length;
-                    }      
-                };
+static RecordHolder &PushRecord()
+{
+    if (prog.read_recs.size() < prog.num_recs + 1)
+    {
+        size_t newcount = (prog.num_recs + 1) * 4;
+        prog.read_recs.resize(newcount);
+    }
 
-                if (rec.atoms.size() > 1)
-                    IterateAtoms(rec, rec.atoms[0], RemoveStringBackslashes, NULL);
+    RecordHolder &result = prog.read_recs[ prog.num_recs ];
+    result.parsed = false;
+    prog.num_recs++;
+    return result;
+}
 
-                //printf("[added %d] %d: %s\n", 
-                //       (int)(out - &prog.read_recs[0]), (int)rec.id, rec.buf.c_str());
-                // @Debug
-                //GDB_PrintRecordAtom(rec, rec.atoms[0], 0);
-            }
-        }
+struct RecordActionName
+{
+    const char *name;
+    RecordAction action;
+};
+
+static constexpr RecordActionName RECORD_ACTION_NAMES[] = 
+{
+    { "done", Action_Done },
+    { "running", Action_Running },
+    { "connected", Action_Connected },
+    { "error", Action_Error },
+    { "exit", Action_Exit },
+    { "stopped", Action_Stopped },
+    { "thread-group-added", Action_ThreadGroupAdded },
+    { "thread-group-removed", Action_ThreadGroupRemoved },
+    { "thread-group-started", Action_ThreadGroupStarted },
+    { "thread-group-exited", Action_ThreadGroupExited },
+    { "thread-created", Action_ThreadCreated },
+    { "thread-exited", Action_ThreadExited },
+    { "thread-selected", Action_ThreadSelected },
+    { "library-loaded", Action_LibraryLoaded },
+    { "library-unloaded", Action_LibraryUnloaded },
+    { "traceframe-changed", Action_TraceframeChanged },
+    { "tsv-created", Action_TsvCreated },
+    { "tsv-deleted", Action_TsvDeleted },
+    { "tsv-modified", Action_TsvModified },
+    { "breakpoint-created", Action_BreakpointCreated },
+    { "breakpoint-modified", Action_BreakpointModified },
+    { "breakpoint-deleted", Action_BreakpointDeleted },
+    { "record-started", Action_RecordStarted },
+    { "record-stopped", Action_RecordStopped },
+    { "cmd-param-changed", Action_CmdParamChanged },
+    { "memory-changed", Action_MemoryChanged },
+};
+
+// perfect hash of the action names into 64 slots, the multiplier was
+// searched for offline. pick another one if the assert below fires
+#define RECORD_ACTION_SLOTS 64
+#define RECORD_ACTION_MULTIPLIER 1359u
+
+constexpr size_t ConstStringLength(const char *str, size_t i = 0)
+{
+    return (str[i] == '\0') ? i : ConstStringLength(str, i + 1);
+}
+
+constexpr uint32_t RecordActionSlot(uint32_t hash)
+{
+    return (uint32_t)(hash * RECORD_ACTION_MULTIPLIER) >> 26;
+}
 
-        // advance to next line, skip over index of NT
-        block_idx = block_idx + linesize;
+constexpr uint32_t RecordActionNameSlot(size_t i)
+{
+    return RecordActionSlot(HashAtomName(RECORD_ACTION_NAMES[i].name, 
+                                         ConstStringLength(RECORD_ACTION_NAMES[i].name)));
+}
+
+constexpr bool RecordActionSlotsUnique(size_t i, size_t j)
+{
+    return (i >= ArrayCount(RECORD_ACTION_NAMES)) 
+        ? true
+        : (j >= ArrayCount(RECORD_ACTION_NAMES)) 
+            ? RecordActionSlotsUnique(i + 1, i + 2)
+            : (RecordActionNameSlot(i) != RecordActionNameSlot(j)) && 
+              RecordActionSlotsUnique(i, j + 1);
+}
+
+static_assert(RECORD_ACTION_SLOTS == (1 << (32 - 26)), "slot count doesn't match the hash shift");
+static_assert(RecordActionSlotsUnique(0, 1), "record action names collide");
+
+struct RecordActionTable
+{
+    uint8_t slots[RECORD_ACTION_SLOTS];     // RECORD_ACTION_NAMES index + 1
+    uint8_t lengths[ ArrayCount(RECORD_ACTION_NAMES) ];
+};
+
+static RecordActionTable BuildRecordActionTable()
+{
+    RecordActionTable result = {};
+    for (size_t i = 0; i < ArrayCount(RECORD_ACTION_NAMES); i++)
+    {
+        result.slots[ RecordActionNameSlot(i) ] = (uint8_t)(i + 1);
+        result.lengths[i] = (uint8_t)strlen(RECORD_ACTION_NAMES[i].name);
     }
+
+    return result;
 }
 
-String GDB_GetRecordAction(const Record &rec)
+RecordAction GDB_ClassifyRecord(const char *action, size_t length)
 {
-    String result;
-    size_t comma = 0;
-    if (rec.buf.size() > 0 &&
-        rec.buf.size() > (comma = rec.buf.find(',')) )
+    static const RecordActionTable table = BuildRecordActionTable();
+
+    // one hash, one slot, one compare to rule out unknown words
+    uint32_t slot = RecordActionSlot( HashAtomName(action, length) );
+    size_t idx = table.slots[slot];
+    if (idx != 0 && table.lengths[idx - 1] == length &&
+        0 == memcmp(RECORD_ACTION_NAMES[idx - 1].name, action, length))
     {
-        size_t start = 1;
-        result = rec.buf.substr(start, comma - start);
+        return RECORD_ACTION_NAMES[idx - 1].action;
     }
 
+    return Action_Unknown;
+}
+
+// set the fields by name, the bitfield packing puts them in an easy to misread order
+static RecordAtom MakeRecordAtom(AtomType type, Span name, Span value)
+{
+    RecordAtom result = {};
+    result.type = type;
+    result.name_index = name.index;
+    result.name_length = name.length;
+    result.value = value;
     return result;
 }
 
 void GDB_GrabBlockData()
 {
-    pthread_mutex_lock(&gdb.modify_block);
+    TRACE_SCOPE(trace, "GDB_GrabBlockData");
+    size_t last_num_recs = prog.num_recs;
 
-    // process the newline terminated records read from the other thread
-    for (Span &iter : gdb.block_spans)
+    // take the lines parsed by the reader thread, give them back afterwards
+    // so their buffers get reused
+    RecordLine *line = NULL;
+    while (0 != RingRead(gdb.from_gdb, &line, 1))
     {
-        GDB_ProcessBlock(gdb.block_data + iter.index, iter.length);
-    }
+        if (!line->is_prompt)
+            WriteToConsoleBuffer(line->text.data(), line->text.size());
+        trace.bytes += line->text.size();
+
+        if (line->is_record)
+        {
+            RecordHolder &out = PushRecord();
+            std::swap(out.rec, line->rec);
 
-    gdb.block_spans.clear();
+            uint32_t id = out.rec.id;
+            if (id != 0 && out.rec.buf[0] == PREFIX_RESULT)
+                LogCommandReply(out.rec, line->read_ns);
 
-    // process any errors found
-    size_t last_num_recs = 0;
-    if (prog.num_recs < last_num_recs)
-        last_num_recs = 0;
+            // hand the first record with a blocking command's token over to it
+            PendingCommand &pending = gdb.pending[ id % ArrayCount(gdb.pending) ];
+            if (id != 0 && pending.id == id && pending.rec_idx == BAD_INDEX)
+                pending.rec_idx = prog.num_recs - 1;
+        }
+
+        // let go of buffers from unusually large records instead of pooling them
+        if (line->text.capacity() > RECORD_LINE_KEEP_SIZE ||
+            line->rec.buf.capacity() > RECORD_LINE_KEEP_SIZE ||
+            0 == RingWrite(gdb.free_lines, &line, 1))
+        {
+            delete line;
+        }
+    }
 
+    // process any errors found
     for (size_t i = last_num_recs; i < prog.num_recs; i++)
     {
         RecordHolder &iter = prog.read_recs[i];
         const char *bufstr = iter.rec.buf.c_str();
-        if ("error" == GDB_GetRecordAction(iter.rec))
+        if (iter.rec.action == Action_Error)
         {
             if (NULL != strstr(bufstr, "optimized out"))
             {
@@ -1300,27 +2369,34 @@ void GDB_GrabBlockData()
                 const Record OPTIMIZED_OUT_FIX = {
                     iter.rec.id,
                     {
-                        { Atom_Array, {0, 0}, {1,1} }, // root atom
-                        { Atom_String, /*value*/{6, 5}, /*<optimized out>*/{13, 15} }
+                        // spans are {index, length}
+                        MakeRecordAtom(Atom_Array, {0, 0}, {1, 1}),                 // root atom
+                        MakeRecordAtom(Atom_String, /*value*/{6, 5}, /*<optimized out>*/{13, 15})
                     },
                     "^done,value=\"<optimized out>\""
                 };
 
-                prog.num_recs++;
-                RecordHolder &last = prog.read_recs[ prog.num_recs - 1 ];
+                RecordHolder &last = PushRecord();
                 last.rec = OPTIMIZED_OUT_FIX;
-                last.parsed = false;
+                last.rec.action = Action_Done;
             }
             else 
             {
+                // async commands carry the echo setting from when they were sent
+                bool echo_no_symbol = gdb.echo_next_no_symbol_in_context;
+                auto cmd = gdb.async_cmds.find(iter.rec.id);
+                if (cmd != gdb.async_cmds.end())
+                    echo_no_symbol = cmd->second.echo_no_symbol_in_context;
+
                 // don't print error on watch variables not in scope (no symbol "xyz" in current context)
                 // don't print error on hovering mouse over a type name
                 if (NULL == strstr(bufstr, "in current context.") ||
-                    gdb.echo_next_no_symbol_in_context)
+                    echo_no_symbol)
                     //NULL == strstr(bufstr, "Attempt to use a type name as an expression"))
                 {
                     // convert error record to GDB console output record
-                    String errmsg = GDB_ExtractValue("msg", iter.rec);
+                    static constexpr AtomPath MSG = "msg";
+                    String errmsg = GDB_ExtractValue(MSG, iter.rec);
 
                     // replace bad description of when an executable doesn't reference a sourcefile
                     static const char *needle = "No source file named";
@@ -1334,7 +2410,4 @@ void GDB_GrabBlockData()
             }
         }
     }
-
-    last_num_recs = prog.num_recs;
-    pthread_mutex_unlock(&gdb.modify_block);
 }
@@ -15,13 +15,24 @@
 
 #pragma once
 
+// aggregate that hasn't hit its closing char yet
+struct ParseFrame
+{
+    RecordAtom atom;
+    size_t child_start_idx;     // first child in ParseRecordContext.pending
+};
+
 struct ParseRecordContext
 {
-    Vector<RecordAtom> atoms;
-    size_t atom_idx;
-    size_t num_end_atoms;   // contiguous atoms stored at the end of atoms
+    Vector<RecordAtom> atoms;   // output in final order, atoms[0] is the root
+    Vector<RecordAtom> pending; // children of aggregates that are still open
+    Vector<ParseFrame> frames;  // aggregates that are still open
+    Vector<uint32_t> index;     // structural char positions from the indexer
+    size_t index_pos;
 
     bool error;
+    const char *error_message;
+    size_t error_idx;
 
     size_t i;
     const char *buf;      // record line data
@@ -38,26 +49,148 @@ struct AtomIter
 };
 AtomIter GDB_IterChild(const Record &rec, const RecordAtom *array);
 
+// FNV-1a of an atom name, folds to a constant for string literals
+constexpr uint32_t HashAtomName(const char *name, size_t length, uint32_t hash = 2166136261u)
+{
+    return (length == 0) 
+        ? hash 
+        : HashAtomName(name + 1, length - 1, (hash ^ (uint8_t)name[0]) * 16777619u);
+}
+
+#define ATOM_PATH_MAX 4
+#define ATOM_NO_ARRAY_INDEX 0xFFFFFFFF
+
+struct AtomPathSegment
+{
+    uint32_t hash;
+    uint32_t index;         // name start in AtomPath.text
+    uint32_t length;
+    uint32_t array_index;   // [n] following the name
+};
+
+// path segments get split and hashed by constexpr functions so a
+// constexpr AtomPath costs nothing at lookup time
+constexpr size_t PathNameEnd(const char *p, size_t i)
+{
+    return (p[i] == '\0' || p[i] == '.' || p[i] == '[') ? i : PathNameEnd(p, i + 1);
+}
+
+constexpr size_t PathCloseBracket(const char *p, size_t i)
+{
+    return (p[i] == '\0') ? i : (p[i] == ']') ? i + 1 : PathCloseBracket(p, i + 1);
+}
+
+constexpr size_t PathNextSegment(const char *p, size_t name_end)
+{
+    return (p[name_end] == '[') 
+        ? PathNextSegment(p, PathCloseBracket(p, name_end)) 
+        : (p[name_end] == '.') ? name_end + 1 : name_end;
+}
+
+constexpr size_t PathSegmentStart(const char *p, size_t segment)
+{
+    return (segment == 0) 
+        ? 0 
+        : PathNextSegment(p, PathNameEnd(p, PathSegmentStart(p, segment - 1)));
+}
+
+constexpr uint32_t PathArrayIndex(const char *p, size_t i, uint32_t value)
+{
+    return (p[i] >= '0' && p[i] <= '9') 
+        ? PathArrayIndex(p, i + 1, value * 10 + (uint32_t)(p[i] - '0')) 
+        : value;
+}
+
+constexpr AtomPathSegment MakePathSegment(const char *p, size_t start, size_t end)
+{
+    return AtomPathSegment{ HashAtomName(p + start, end - start), 
+                            (uint32_t)start, (uint32_t)(end - start),
+                            (p[end] == '[') ? PathArrayIndex(p, end + 1, 0) : ATOM_NO_ARRAY_INDEX };
+}
+
+constexpr AtomPathSegment GetPathSegment(const char *p, size_t segment)
+{
+    return MakePathSegment(p, PathSegmentStart(p, segment), 
+                           PathNameEnd(p, PathSegmentStart(p, segment)));
+}
+
+constexpr uint32_t CountPathSegments(const char *p, size_t start = 0, uint32_t count = 0)
+{
+    return (p[start] == '\0') 
+        ? count 
+        : CountPathSegments(p, PathNextSegment(p, PathNameEnd(p, start)), count + 1);
+}
+
+// dot separated child names with optional array indices, parsed once
+// ex: "bkpt.fullname", "stack[0].frame.addr"
+struct AtomPath
+{
+    const char *text;
+    uint32_t num_segments;
+    AtomPathSegment segments[ATOM_PATH_MAX];
+
+    constexpr AtomPath(const char *path)
+        : text(path), num_segments(CountPathSegments(path)),
+          segments{ GetPathSegment(path, 0), GetPathSegment(path, 1),
+                    GetPathSegment(path, 2), GetPathSegment(path, 3) } 
+    {}
+};
+
+// fill in Record.name_hashes for the current atoms
+void GDB_HashRecordNames(Record &rec);
+
 // extract values from parsed records
-String GDB_ExtractValue(const char *name, const RecordAtom &root, const Record &rec);
-int GDB_ExtractInt(const char *name, const RecordAtom &root, const Record &rec);
-const RecordAtom *GDB_ExtractAtom(const char *name, const RecordAtom &root, const Record &rec);
+// views point into Record.buf and are valid as long as the record is
+StringView GDB_ExtractView(const AtomPath &path, const RecordAtom &root, const Record &rec);
+String GDB_ExtractValue(const AtomPath &path, const RecordAtom &root, const Record &rec);
+int GDB_ExtractInt(const AtomPath &path, const RecordAtom &root, const Record &rec);
+const RecordAtom *GDB_ExtractAtom(const AtomPath &path, const RecordAtom &root, const Record &rec);
 
 // helper functions for searching the root node of a record 
-String GDB_ExtractValue(const char *name, const Record &rec);
-int GDB_ExtractInt(const char *name, const Record &rec);
-const RecordAtom *GDB_ExtractAtom(const char *name, const Record &rec);
+StringView GDB_ExtractView(const AtomPath &path, const Record &rec);
+String GDB_ExtractValue(const AtomPath &path, const Record &rec);
+int GDB_ExtractInt(const AtomPath &path, const Record &rec);
+const RecordAtom *GDB_ExtractAtom(const AtomPath &path, const Record &rec);
+
+// resolve the backslash escapes of the marked string atoms in place,
+// done once after parsing before the record is handed out
+void GDB_UnescapeRecord(Record &rec);
 
-inline String GetAtomString(Span s, const Record &rec)
+inline StringView GetAtomView(const RecordAtom &atom, const Record &rec)
 {
-    Assert(s.index + s.length <= rec.buf.size());
-    String result = {};
-    result.assign(rec.buf.data() + s.index, s.length);
+    Assert(!atom.has_escapes);
+    Assert(atom.value.index + atom.value.length <= rec.buf.size());
+    StringView result = { rec.buf.data() + atom.value.index, atom.value.length };
     return result;
 }
 
+inline String GetAtomString(const RecordAtom &atom, const Record &rec)
+{
+    return ToString( GetAtomView(atom, rec) );
+}
+
+// start GDB or the gdb.replay_filename stand-in, then query its features
 bool GDB_StartProcess(String gdb_filename, String gdb_args);
 
+#define TRANSCRIPT_HEADER "# tug transcript 1\n"
+#define TRANSCRIPT_TO_GDB '>'
+#define TRANSCRIPT_FROM_GDB '<'
+
+// chunk of MI traffic from a --record transcript
+struct TranscriptEntry
+{
+    uint64_t time_us;       // since the recording started
+    char direction;         // TRANSCRIPT_TO_GDB or TRANSCRIPT_FROM_GDB
+    String data;            // exact bytes written or read
+};
+
+// write everything exchanged with GDB to filename, a directory gets a 
+// timestamped transcript inside of it. call before GDB is started
+bool GDB_StartRecording(const char *filename);
+
+bool GDB_ParseTranscript(const String &data, Vector<TranscriptEntry> &out);
+bool GDB_LoadTranscript(const char *filename, Vector<TranscriptEntry> &out);
+
 bool GDB_SetInferiorExe(String filename);
 
 bool GDB_SetInferiorArgs(String args);
@@ -73,17 +206,32 @@ bool GDB_SendBlocking(const char *cmd, bool remove_after = true);
 // send a message to GDB, wait for a result record, then retrieve it
 bool GDB_SendBlocking(const char *cmd, Record &rec);
 
+// send a message to GDB, callback is given the result record on the UI thread
+// by GDB_DispatchAsync. any number of these can be in flight
+bool GDB_SendAsync(const char *cmd, AsyncCallback callback);
+
+// hand the result records found so far to their GDB_SendAsync callbacks, fail
+// the ones past their timeout. returns when the next one times out, 0 for none
+uint64_t GDB_DispatchAsync();
+
 // extract a MI record from a newline terminated line
 bool GDB_ParseRecord(char *buf, size_t bufsize, ParseRecordContext &ctx);
 
+// split the record id off of a newline terminated interpreter line, then
+// parse result/async records and resolve their string literals
+void GDB_ParseLine(const char *line, size_t linesize, ParseRecordContext &ctx, RecordLine &out);
+
 // first word after record type char
 // ex: ^done, *stopped
-String GDB_GetRecordAction(const Record &rec);
+RecordAction GDB_ClassifyRecord(const char *action, size_t length);
 
 void GDB_GrabBlockData();
 
 RecordAtomSequence GDB_RecurseEvaluation(ParseRecordContext &ctx);
 
+// parse the value of a -data-evaluate-expression into ctx.atoms
+bool GDB_ParseEvaluation(const char *buf, size_t bufsize, ParseRecordContext &ctx);
+
 typedef void AtomIterator(Record &rec, RecordAtom &iter, void *ctx);
 void IterateAtoms(Record &rec, RecordAtom &iter, AtomIterator *iterator, void *ctx);
 
@@ -19,13 +19,19 @@
 
 #include <fstream>
 #include <functional>
+#include <algorithm>
+#include <float.h>
 
 // third party
 #include <imgui/imconfig.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
 #include <imgui/imgui_impl_glfw.h>
+#if defined(TUG_HEADLESS)
+#define GLFW_INCLUDE_NONE
+#else
 #include <imgui/imgui_impl_opengl2.h>
+#endif
 #include <GLFW/glfw3.h>
 #include <imgui_file_window.h>
 #include "liberation_mono.h"
@@ -328,14 +334,41 @@ struct Session
     String debug_args;
 };
 
+// windows timed for --bench-frames
+enum DrawWindow
+{
+    DrawWindow_Source,
+    DrawWindow_Disassembly,     // inside of the source window
+    DrawWindow_Console,         // control window
+    DrawWindow_Locals,
+    DrawWindow_Watch,
+    DrawWindow_Callstack,
+    DrawWindow_Threads,
+    DrawWindow_Breakpoints,
+    DrawWindow_DirectoryViewer,
+    DrawWindow_MITraffic,
+    DrawWindow_Count,
+};
+
+static const char *DRAW_WINDOW_NAMES[DrawWindow_Count] = 
+{
+    "source", "disassembly", "console", "locals", 
+    "watch", "callstack", "threads", "breakpoints", "directory viewer", "mi traffic",
+};
+
 struct GUI
 {
     // GLFW data set through custom callbacks
     struct 
     {
         float vert_scroll_increments;
+        bool window_event;                      // refresh, resize or drop, outside of imgui input
+        uint64_t draw_ns[DrawWindow_Count];     // cpu time spent in each window
     } this_frame;
 
+    // main loop sleeps until input, GDB or inferior output, or this glfwGetTime
+    double redraw_time;
+
     GLFWwindow *window;
     LineDisplay line_display = LineDisplay_Source;
     Vector<DisassemblyLine> line_disasm;
@@ -372,6 +405,7 @@ struct GUI
     bool show_watch;
     bool show_breakpoints;
     bool show_threads;
+    bool show_mi_traffic;
     bool show_directory_viewer;
     bool show_tutorial;
     bool show_about_tug;
@@ -380,6 +414,9 @@ struct GUI
     int hover_delay_ms;
     String drag_drop_exe_path;
 
+    // GLFW null platform, nothing gets rendered or presented
+    bool headless;
+
     // shutdown variables
     bool started_imgui_opengl2;
     bool started_imgui_glfw;
@@ -387,21 +424,63 @@ struct GUI
     bool initialized_glfw;
 };
 
+// --bench-stops, time every stop from the *stopped record to the first
+// frame drawn with all of the query results
+enum StopPhase
+{
+    StopPhase_Gdb,          // step command sent -> *stopped handled
+    StopPhase_Stack,
+    StopPhase_Locals,
+    StopPhase_VarUpdate,
+    StopPhase_Watches,
+    StopPhase_Disassembly,
+    StopPhase_Frame,
+    StopPhase_Count,
+};
+
+struct StopBench
+{
+    size_t num_stops;                       // stops to measure, 0 when not benchmarking
+    bool requested;                         // --bench-stops given, stays set after the run ends
+    size_t num_measured;
+    size_t step_idx;                        // next command in STOP_BENCH_STEPS
+    uint64_t sent_ns;                       // last step command sent
+    uint64_t stopped_ns;                    // *stopped handled, 0 while running
+    uint64_t phase_ns[StopPhase_Count];     // per stop, 0 if the phase didn't happen
+    Vector<uint64_t> latency_ns[StopPhase_Count];
+};
+
 Program prog;
 GDB gdb;
 GUI gui;
+StopBench stop_bench;
+
+// --bench-frames, cpu time of Draw per window over a number of frames
+struct FrameBench
+{
+    size_t num_frames;                      // frames to draw, 0 when not benchmarking
+    size_t scale;                           // multiplier for the scripted debug state
+    size_t num_drawn;
+    Vector<uint64_t> draw_ns[DrawWindow_Count];
+    Vector<uint64_t> frame_ns;              // all of Draw
+};
+
+FrameBench frame_bench;
+
+// --trace, chrome trace json written at exit, tracing stays on while set
+String trace_filename;
 
 void dbg() {}
 
 
-static uint64_t ParseHex(const String &str)
+static uint64_t ParseHex(StringView str)
 {
     uint64_t result = 0;
     uint64_t pow = 1;
-    for (size_t i = str.size() - 1; i < str.size(); i--)
+    for (size_t i = str.size - 1; i < str.size; i--)
     {
         uint64_t num = 0;
-        char c = str[i];
+        char c = str.data[i];
         if (c == 'x' || c == 'X') 
             break;
 
@@ -479,86 +558,6 @@ static void SetWindowTheme(WindowTheme theme)
     gui.window_theme = theme;
 }
 
-bool LoadFile(File &file)
-{
-    bool result = false;
-    struct stat sb = {};
-    if (file.lines.size() == 0 && 
-        0 == stat(file.filename.c_str(), &sb))
-    {
-        FILE *f = fopen(file.filename.c_str(), "rb");
-        if (f == NULL)
-        {
-            PrintErrorf("fopen %s\n", GetErrorString(errno));
-        }
-        else
-        {
-            size_t filesize = sb.st_size;
-            file.data.resize(filesize);
-            if (0 < fread((void*)file.data.data(), 1, filesize, f))
-            {
-                // move file up so that the data will be packed
-                // lines will be accessed by offsetting into one big buf
-                char *fd = (char*)file.data.data();
-                size_t i = 0;
-                char *lst = fd;
-                size_t num_trunc = 0;
-
-                while (i < filesize)
-                {
-                    char c0 = fd[i];
-                    char c1 = (i + 1 < filesize) ? fd[i + 1] : '\0';
-                    size_t end = (c0 == '\n') ? 1 :
-                        (c0 == '\r' && c1 == '\n') ? 2 :
-                        (c0 == '\r') ? 1 : 0;
-
-                    if (end != 0)
-                    {
-                        char *dest = lst - num_trunc;
-                        memmove(dest, lst, (fd + i) - lst);
-
-                        file.lines.push_back(dest - fd);
-
-                        num_trunc += end;
-                        i += end;
-                        lst = fd + i;
-                    }
-                    else
-                    {
-                        i++;
-                    }
-                }
-
-                // truncate file to size minus sum of line endings
-                file.data.resize(file.data.size() - num_trunc);
-            }
-
-            // TODO: possibly not the longest line when line number is large enough
-            // format is [breakpoint] [ %-4d line number] [line]
-            file.longest_line_idx = 0;
-            size_t max_chars = 0;
-            size_t len = file.data.size();
-            for (size_t i = file.lines.size() - 1; i < file.lines.size(); i--)
-            {
-                size_t this_line_len = len - file.lines[i];
-                if (max_chars < this_line_len)
-                {
-                    max_chars = this_line_len;
-                    file.longest_line_idx = i;
-                }
-
-                len = file.lines[i];
-            }
-
-            fclose(f); f = NULL;
-
-            result = true;
-        }
-    }
-
-    return result;
-}
-
 static void HelpText(const char *text)
 {
     // when in the tutorial mode, hover over items to see its description
@@ -578,32 +577,54 @@ static void HelpText(const char *text)
     }
 }
 
-static size_t FindOrCreateFile(const String &filename)
+static size_t FindOrCreateFile(StringView filename)
 {
-    size_t result = BAD_INDEX;
-
-    // search for the stored file context
-    for (size_t i = 0; i < prog.files.size(); i++)
+    // every frame and breakpoint record names its file, look up the
+    // spelling we were given without allocating once it has been seen
+    static String key;
+    key.assign(filename.data, filename.size);
+    auto spelling = prog.file_spellings.find(key);
+    if (spelling != prog.file_spellings.end())
+        return spelling->second;
+
+    // new spelling, resolve it so ../src/a.c and src/a.c are one file.
+    // keep the name as is when it doesn't exist (yet)
+    String path = key;
+    char *canonical = realpath(key.c_str(), NULL);
+    if (canonical != NULL)
     {
-        if (prog.files[i].filename == filename)
-        {
-            result = i;
-            break;
-        }
+        path = canonical;
+        free(canonical);
     }
 
-    // file not found add new entry
-    // load file lines on calling LoadFile
-    if (result == BAD_INDEX)
+    size_t result = BAD_INDEX;
+    auto iter = prog.file_paths.find(path);
+    if (iter != prog.file_paths.end())
+    {
+        result = iter->second;
+    }
+    else
     {
+        // file not found add new entry
+        // load file lines on calling LoadFile
         result = prog.files.size();
         prog.files.resize(prog.files.size() + 1);
-        prog.files[result].filename = filename;
+        prog.files[result].filename = path;
+        prog.file_paths[path] = result;
     }
 
+    prog.file_spellings[key] = result;
     return result;
 }
 
+static size_t FindOrCreateFile(const char *filename)
+{
+    StringView view = {};
+    view.data = filename;
+    view.size = strlen(filename);
+    return FindOrCreateFile(view);
+}
+
 #define ImGuiDisabled(is_disabled, code)\
 ImGui::BeginDisabled(is_disabled);\
 code;\
@@ -619,32 +640,8 @@ void WriteToConsoleBuffer(const char *buf, size_t bufsize)
     if (is_mi_record && !gui.show_machine_interpreter_commands)
         return;
 
-    // truncate messages too large
-    bufsize = GetMin(bufsize, sizeof(prog.log));
-
-    const auto PushChar = [&](char c)
-    {
-        Assert(prog.log_idx <= sizeof(prog.log));
-        if (prog.log_idx == sizeof(prog.log))
-        {
-            // exhaused log data, pop memory from the front
-            size_t i = sizeof(prog.log) / 16;
-            while (i < sizeof(prog.log) && (prog.log[i] != '\n' && prog.log[i] != '\0'))
-            {
-                i++; // walk until the end of a line or unused data
-            }
-
-            // move line data up, clear moved area
-            Assert(prog.log_idx >= i);
-            memmove(prog.log, prog.log + i, prog.log_idx - i);
-            prog.log_idx -= i;
-            memset(prog.log + prog.log_idx, 0, sizeof(prog.log) - prog.log_idx);
-        }
-
-        if (c == '\n' || (c >= 32 && c <= 126))
-            prog.log[prog.log_idx++] = c;
-    };
-
+    // decoded into a reused buffer then appended in bulk
+    static String decoded;
     if (bufsize > 2 && 
         (buf[0] == PREFIX_DEBUG_LOG ||
          buf[0] == PREFIX_TARGET_LOG ||
@@ -653,240 +650,124 @@ void WriteToConsoleBuffer(const char *buf, size_t bufsize)
     {
         // console record, format ~"text text text"\n
         // skip over the beginning/ending characters
-        size_t i = 2;
-        bufsize -= 2;
-
-        for (; i < bufsize; i++)
-        {
-            char c = buf[i];
-            char n = (i + 1 < bufsize) ? buf[i + 1] : '\0';
-
-            if (c == '\\')
-            {
-                switch (n)
-                {
-                    case 'n':
-                        PushChar('\n');
-                        break;
-                    case 't': 
-                        for (size_t t = 0; t < 2; t++)
-                            PushChar(' ');
-                        break;
-                    case '\\':
-                    case '\"':
-                        PushChar(n);
-                        break;
-                    default:
-                        break;
-                }
-
-                i++; // skip over the evaluated literal char
-            }
-            else
-            {
-                PushChar(buf[i]);
-            }
-        }
+        size_t textsize = (bufsize > 4) ? bufsize - 4 : 0;
+        ConsoleDecode(buf + 2, textsize, true, decoded);
     }
     else
     {
         // text that isn't a log record ex: shell ls
-        for (size_t i = 0; i < bufsize; i++)
-            PushChar(buf[i]);
+        ConsoleDecode(buf, bufsize, false, decoded);
 
         // newline is chopped in user input, parsed as MI record
         // Printf newline isn't chopped, check last char 
         if (bufsize > 0 && buf[bufsize - 1] != '\n')
-            PushChar('\n');
+            decoded += '\n';
     }
 
-    prog.log_scroll_to_bottom = true;
+    ConsoleAppend(prog.log, decoded.data(), decoded.size());
 }
 
-VarObj CreateVarObj(String name, String value = "")
+// inferior output read from the pty by its own thread so it can wake the
+// UI thread, written to the console on the next frame
+static pthread_mutex_t inferior_output_lock = PTHREAD_MUTEX_INITIALIZER;
+static String inferior_output;
+#define INFERIOR_OUTPUT_MAX (4 * 1024 * 1024)      // between two frames
+
+// bumped on every WakeUIThread so the main loop can tell a wake from a timeout
+static std::atomic<uint32_t> num_ui_wakes;
+static std::atomic<bool> can_wake_ui;   // set while the GLFW window exists
+
+void WakeUIThread()
 {
-    VarObj result = {};
-    result.name = name;
-    result.value = value;
-    result.changed = true;
-    
-    if (result.value == "") 
-    {
-        result.value = "???";
-    }
+    // called from the reader threads, don't get cancelled inside of GLFW
+    int oldstate;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldstate);
+    num_ui_wakes.fetch_add(1);
+    if (can_wake_ui.load())
+        glfwPostEmptyEvent();
+    pthread_setcancelstate(oldstate, NULL);
+}
 
-    if (result.value[0] == '{')
+static void *ReadInferiorOutput(void *)
+{
+    while (true)
     {
-        static bool resize_once = true;
-        value = name + " = " + value;
-        static struct ParseRecordContext ctx = {};
+        pollfd p = {};
+        p.fd = gdb.fd_ptty_master;
+        p.events = POLLIN;
 
-        if (resize_once)
+        int rc = poll(&p, 1, -1);
+        if (rc < 0)
         {
-            resize_once = false;
-            ctx.atoms.resize( 16 * 1024 ); // @Hack
-        }
+            if (errno == EINTR)
+                continue;
 
-        ctx.i = 0;
-        ctx.atom_idx = 0;
-        ctx.num_end_atoms = 0;
-        ctx.error = false;
-        ctx.buf = value.c_str();
-        ctx.bufsize = value.size();
+            fprintf(stderr, "inferior poll %s\n", GetErrorString(errno));
+            break;
+        }
 
-        RecordAtom root = GDB_RecurseEvaluation(ctx).atom;
+        // the slave is held open so a hangup means the pty is gone
+        if ((p.revents & POLLIN) == 0)
+            break;
 
-        if (!ctx.error)
+        char buf[1024];
+        ssize_t bytes_read = read(gdb.fd_ptty_master, buf, sizeof(buf));
+        if (bytes_read <= 0)
         {
-            // put the root in place since it doesn't get popped to the 
-            // ordered section of the array
-            ctx.num_end_atoms++;
+            if (bytes_read < 0 && errno == EINTR)
+                continue;
 
-            // atoms are in order at the end of the array,
-            // subtract the difference from base ordered
-            Assert(ctx.num_end_atoms <= ctx.atoms.size());
-            size_t ordered_offset = ctx.atoms.size() - ctx.num_end_atoms;
-            RecordAtom *ordered_base = &ctx.atoms[ ordered_offset ];
-            ordered_base[0] = root;
+            fprintf(stderr, "inferior read %s\n", GetErrorString(errno));
+            break;
+        }
 
-            for (size_t i = 0; i < ctx.num_end_atoms; i++)
-            {
-                RecordAtom *atom = &ordered_base[i];
-                if ( (atom->type == Atom_Array || atom->type == Atom_Struct) &&
-                     (atom->value.length != 0))
-                {
-                    // adjust aggregate offset
-                    Assert(atom->value.index > ordered_offset);
-                    atom->value.index -= ordered_offset;
-                }
-            }
+        // hold off when the UI thread is far behind, the inferior blocks
+        // on a full pty instead of its output getting dropped
+        while (true)
+        {
+            pthread_mutex_lock(&inferior_output_lock);
+            bool has_space = (inferior_output.size() < INFERIOR_OUTPUT_MAX);
+            if (has_space)
+                inferior_output.append(buf, bytes_read);
+            pthread_mutex_unlock(&inferior_output_lock);
 
-            result.expr.atoms.resize(ctx.num_end_atoms);
-            memcpy(&result.expr.atoms[0], 
-                   &ctx.atoms[ ctx.atoms.size() - ctx.num_end_atoms ],
-                   sizeof(RecordAtom) * ctx.num_end_atoms);
-            result.expr.buf = value;
-            result.expr_changed.resize( ctx.num_end_atoms );
-
-            //GDB_PrintRecordAtom(result.expr, result.expr.atoms[0], 0, out);
-            // remove format backslashes in atom strings
-            // ignore those of name "value" because these get handled in GDB_RecurseEvaluation
-            const auto RemoveStringBackslashes = [](Record &record, RecordAtom &iter, void * /* user context */)
-            {
-                if (iter.type == Atom_String)
-                {
-                    size_t new_length = iter.value.length;
-                    for (size_t i = 0; i < iter.value.length; i++)
-                    {
-                        size_t buf_idx = iter.value.index + i;
-                        char c = record.buf[buf_idx];
-                        char n = (i + 1 < iter.value.length) ? record.buf[buf_idx + 1] : '\0';
-                        if (c == '\\' && (n == '\\' || n == '\"'))
-                        {
-                            //record.buf[iter.value.index + new_length - 1] = ' ';
-                            memmove(&record.buf[buf_idx], &record.buf[buf_idx + 1], iter.value.length - (i + 1));
-                            new_length--;
-                        }
-                    }
-                    iter.value.length = new_length;
-                }      
-            };
+            WakeUIThread();
+            if (has_space)
+                break;
 
-            if (result.expr.atoms.size() > 1)
-                IterateAtoms(result.expr, result.expr.atoms[0], RemoveStringBackslashes, NULL);
+            usleep(1000);
         }
     }
 
-    return result;
+    return NULL;
 }
 
-bool RecurseCheckChanged(VarObj &this_var, size_t this_parent_idx,
-                         const VarObj &last_var, size_t last_parent_idx)
+// draw another frame after delay_seconds even if nothing else wakes the UI thread
+static void RequestRedraw(double delay_seconds = 0.0)
 {
-    bool changed = false;
-    Assert((this_parent_idx < this_var.expr.atoms.size()) && 
-           (last_parent_idx < last_var.expr.atoms.size()));
-
-    RecordAtom &this_parent = this_var.expr.atoms[ this_parent_idx ];
-    const RecordAtom &last_parent = last_var.expr.atoms[ last_parent_idx ];
-    Assert( (this_parent.type == Atom_Struct || this_parent.type == Atom_Array) &&
-            (this_parent.type == last_parent.type) );
-
-    if (this_parent.value.length == last_parent.value.length)
-    {
-        size_t t_idx = this_parent.value.index;
-        size_t t_end = t_idx + this_parent.value.length;
-        size_t o_idx = last_parent.value.index;
-        size_t o_end = o_idx + last_parent.value.length;
-
-        for (; t_idx < t_end && o_idx < o_end; t_idx++, o_idx++)
-        {
-            const RecordAtom &this_child = this_var.expr.atoms[t_idx];
-            const RecordAtom &last_child = last_var.expr.atoms[o_idx];
-            if (this_child.type == Atom_Struct || this_child.type == Atom_Array)
-            {
-                changed |= RecurseCheckChanged(this_var, t_idx, 
-                                               last_var, o_idx);
-            }
-            else if (this_child.type == Atom_String)
-            {
-                const char *this_buf = this_var.expr.buf.c_str();
-                const char *last_buf = last_var.expr.buf.c_str();
-
-                Assert(this_child.value.index + this_child.value.length <=
-                       this_var.expr.buf.size());
-                Assert(last_child.value.index + last_child.value.length <=
-                       last_var.expr.buf.size());
-
-                const char *this_text = this_buf + this_child.value.index;
-                const char *last_text = last_buf + last_child.value.index;
+    double redraw_time = glfwGetTime() + delay_seconds;
+    if (redraw_time < gui.redraw_time)
+        gui.redraw_time = redraw_time;
+}
 
-                this_var.expr_changed[t_idx] 
-                    = (this_child.value.length != last_child.value.length) ||
-                    (0 != memcmp(this_text, last_text, this_child.value.length));
+// window time for --bench-frames and the trace, exclude_ns is nested window time
+static void AddDrawTime(DrawWindow window, uint64_t start_ns, uint64_t exclude_ns = 0)
+{
+    uint64_t elapsed_ns = GetNanoseconds() - start_ns - exclude_ns;
+    gui.this_frame.draw_ns[window] += elapsed_ns;
 
-                changed |= this_var.expr_changed[t_idx];
-            }
-            else
-            {
-                Assert(false);
-            }
-        }
-    }
-    else
+    if (IsTraceEnabled())
     {
-        // atom array/struct changed its length, set all to changed
-        changed = true;
-        size_t t_idx = this_parent.value.index;
-        size_t t_end = t_idx + this_parent.value.length;
-        for (size_t i = t_idx; i < t_end; i++)
+        static size_t stats[DrawWindow_Count];
+        static bool stats_interned;
+        if (!stats_interned)
         {
-            this_var.expr_changed[i] = true;
+            for (size_t w = 0; w < DrawWindow_Count; w++)
+                stats[w] = TraceGetStat( ("draw " + String(DRAW_WINDOW_NAMES[w])).c_str() );
+            stats_interned = true;
         }
-    }
 
-    this_var.expr_changed[this_parent_idx] = changed;
-    return changed;
-}
-
-void CheckIfChanged(VarObj &this_var, const VarObj &last_var)
-{
-    bool this_agg = this_var.value[0] == '{';
-    bool last_agg = last_var.value[0] == '{';
-    if (this_agg && last_agg)
-    {
-        // aggregate, go through each child and check if it changed
-        this_var.changed = RecurseCheckChanged(this_var, 0, last_var, 0);
-    }
-    else if (!this_agg && !last_agg)
-    {
-        this_var.changed = (this_var.value != last_var.value);
-    }
-    else
-    {
-        this_var.changed = true;
-        for (size_t i = 0; i < this_var.expr_changed.size(); i++)
-            this_var.expr_changed[i] = true;
+        TraceRecord(stats[window], start_ns, elapsed_ns);
     }
 }
 
@@ -933,10 +814,16 @@ bool ExecuteCommand(const char *cmd, bool remove_after = true)
     return result; 
 }
 
+static void MarkStopPhase(StopPhase phase)
+{
+    // results can come in for several of the same phase, keep the last one
+    if (stop_bench.stopped_ns != 0)
+        stop_bench.phase_ns[phase] = GetNanoseconds() - stop_bench.stopped_ns;
+}
+
 void QueryWatchlist()
 {
     // evaluate user defined watch variables
-    Record rec;
     for (VarObj &iter : prog.watch_vars)
     {
         String expr;
@@ -957,65 +844,83 @@ void QueryWatchlist()
         String cmd = StringPrintf("-data-evaluate-expression --frame %zu --thread %d \"%s\"", 
                                   prog.frame_idx, GetActiveThreadID(), expr.c_str());
 
-        VarObj incoming = {};
-        incoming.name = iter.name;
-        incoming.value = "???";
-        if (GDB_SendBlocking(cmd.c_str(), rec))
+        // watch can get removed or reordered before the result comes back
+        String watch_name = iter.name;
+        GDB_SendAsync(cmd.c_str(), [watch_name](const Record &rec, bool ok)
         {
-            static uint32_t counter = 0;
-            String exprname = StringPrintf("expression##%u", counter);
-            counter++;
+            TRACE_SCOPE(trace, "QueryFrame watch");
+            VarObj incoming = {};
+            incoming.name = watch_name;
+            incoming.value = "???";
+            if (ok)
+            {
+                static uint32_t counter = 0;
+                String exprname = StringPrintf("expression##%u", counter);
+                counter++;
 
-            incoming = CreateVarObj(exprname, GDB_ExtractValue("value", rec));
-        }
+                static constexpr AtomPath VALUE = "value";
+                incoming = CreateVarObj(exprname, GDB_ExtractValue(VALUE, rec));
+            }
+
+            for (VarObj &watch : prog.watch_vars)
+            {
+                if (watch.name == watch_name)
+                {
+                    CheckIfChanged(incoming, watch);
+                    watch.value = incoming.value;
+                    watch.expr = incoming.expr;
+                    watch.changed = incoming.changed;
+                    watch.expr_changed = incoming.expr_changed;
+                    break;
+                }
+            }
 
-        CheckIfChanged(incoming, iter);
-        iter.value = incoming.value;
-        iter.expr = incoming.expr;
-        iter.changed = incoming.changed;
-        iter.expr_changed = incoming.expr_changed;
+            MarkStopPhase(StopPhase_Watches);
+        });
     }
 }
 
-void GetFunctionDisassembly(const Frame &frame)
+static void ReadFunctionDisassembly(const Record &rec, bool has_source)
 {
-    char tmpbuf[4096];
-    Record rec = {};
     gui.line_disasm.clear();
     gui.line_disasm_source.clear();
 
-    // functions with this name don't support function disassembly from address or file/line combos
-    // found this type of function in file: /lib64/ld-linux-x86-64.so.2
-    if (frame.func == "??")
-        return;
-
-    const File &file = prog.files[frame.file_idx];
-    if (file.lines.size() == 0)
+    const auto ReadInstruction = [&](const RecordAtom &line_asm_inst) -> DisassemblyLine
     {
-        if (!gdb.has_data_disassemble_option_a)
-        {
-            return; // operation not supported, bail early
-        }
-        else 
-        {
-            // some frames don't have an associated file ex: _start function after returning from main
-            tsnprintf(tmpbuf, "-data-disassemble -a %s 0", // 0 = disasm only
-                      frame.func.c_str());
-        }
-    }
-    else
-    {
-        // -n -1 = disassemble all lines in the function its contained in
-        // 5 = source and disasm with opcodes
-        tsnprintf(tmpbuf, "-data-disassemble -f \"%s\" -l %zu -n -1 5",
-                  file.filename.c_str(), frame.line_idx + 1);
-    } 
-    
-
-    GDB_SendBlocking(tmpbuf, rec);
+        // unnamed struct 
+        //     address="0x0000555555555248"
+        //     func-name="main"
+        //     offset="176"
+        //     opcodes="74 05"
+        //     inst="je     0x55555555524f <main+183>"
+
+        // looked up for every instruction, keep the paths constant
+        static constexpr AtomPath ADDRESS = "address";
+        static constexpr AtomPath FUNC_NAME = "func-name";
+        static constexpr AtomPath OFFSET = "offset";
+        static constexpr AtomPath INST = "inst";
+
+        char tmpbuf[4096];
+        StringView string_addr = GDB_ExtractView(ADDRESS, line_asm_inst, rec);
+        StringView func = GDB_ExtractView(FUNC_NAME, line_asm_inst, rec);
+        StringView offset_from_func = GDB_ExtractView(OFFSET, line_asm_inst, rec);
+        StringView inst = GDB_ExtractView(INST, line_asm_inst, rec);
+
+        tsnprintf(tmpbuf, "%.*s <%.*s+%.*s> %.*s", 
+                  (int)string_addr.size, string_addr.data, 
+                  (int)func.size, func.data,
+                  (int)offset_from_func.size, offset_from_func.data, 
+                  (int)inst.size, inst.data);
+
+        DisassemblyLine add = {};
+        add.addr = ParseHex(string_addr);
+        add.text = tmpbuf;
+        return add;
+    };
 
-    const RecordAtom *instrs = GDB_ExtractAtom("asm_insns", rec);
-    if (file.lines.size() != 0)
+    static constexpr AtomPath ASM_INSNS = "asm_insns";
+    const RecordAtom *instrs = GDB_ExtractAtom(ASM_INSNS, rec);
+    if (has_source)
     {
         for (const RecordAtom &src_and_asm_line : GDB_IterChild(rec, instrs))
         {
@@ -1024,41 +929,23 @@ void GetFunctionDisassembly(const Frame &frame)
             //     file="debug.c"
             //     fullname="/mnt/c/Users/Kyle/Documents/Visual Studio 2017/Projects/Tug/debug.c"
             //     line_asm_insn
+            static constexpr AtomPath LINE_ASM_INSN = "line_asm_insn";
+            static constexpr AtomPath LINE = "line";
+
             bool is_first_inst = true;
             DisassemblySourceLine line_src = {};
-            const RecordAtom *atom = GDB_ExtractAtom("line_asm_insn", src_and_asm_line, rec);
-            line_src.line_idx = (size_t)GDB_ExtractInt("line", src_and_asm_line, rec) - 1;
+            const RecordAtom *atom = GDB_ExtractAtom(LINE_ASM_INSN, src_and_asm_line, rec);
+            line_src.line_idx = (size_t)GDB_ExtractInt(LINE, src_and_asm_line, rec) - 1;
             line_src.num_instructions = 0;
 
             for (const RecordAtom &line_asm_inst : GDB_IterChild(rec, atom))
             {
-                // array of unnamed struct 
-                //     address="0x0000555555555248"
-                //     func-name="main"
-                //     offset="176"
-                //     opcodes="74 05"
-                //     line_asm_inst="je     0x55555555524f <main+183>"
-
-                DisassemblyLine add = {};
-                String string_addr = GDB_ExtractValue("address", line_asm_inst, rec);
-                String func = GDB_ExtractValue("func-name", line_asm_inst, rec);
-                String offset_from_func = GDB_ExtractValue("offset", line_asm_inst, rec);
-                String inst = GDB_ExtractValue("inst", line_asm_inst, rec);
-                String opcodes = GDB_ExtractValue("opcodes", line_asm_inst, rec);
-
-
-                tsnprintf(tmpbuf, "%s <%s+%s> %s", 
-                          string_addr.c_str(), func.c_str(),
-                          offset_from_func.c_str(), inst.c_str());
-
-                add.addr = ParseHex(string_addr);
-                add.text = tmpbuf;
-                gui.line_disasm.emplace_back(add);
+                gui.line_disasm.emplace_back( ReadInstruction(line_asm_inst) );
                 line_src.num_instructions++;
 
                 if (is_first_inst)
                 {
-                    line_src.addr = add.addr;
+                    line_src.addr = gui.line_disasm.back().addr;
                     is_first_inst = false;
                 }
             }
@@ -1070,30 +957,54 @@ void GetFunctionDisassembly(const Frame &frame)
     {
         // getting function disassembly for a fileless frame
         for (const RecordAtom &line_asm_inst : GDB_IterChild(rec, instrs))
-        {
-            // array of unnamed struct 
-            //     address="0x0000555555555248"
-            //     func-name="main"
-            //     offset="176"
-            //     opcodes="74 05"
-            //     inst="je     0x55555555524f <main+183>"
+            gui.line_disasm.emplace_back( ReadInstruction(line_asm_inst) );
+    }
+}
 
-            DisassemblyLine add = {};
-            String string_addr = GDB_ExtractValue("address", line_asm_inst, rec);
-            String func = GDB_ExtractValue("func-name", line_asm_inst, rec);
-            String offset_from_func = GDB_ExtractValue("offset", line_asm_inst, rec);
-            String inst = GDB_ExtractValue("inst", line_asm_inst, rec);
-            String opcodes = GDB_ExtractValue("opcodes", line_asm_inst, rec);
+void GetFunctionDisassembly(const Frame &frame)
+{
+    char tmpbuf[4096];
 
-            tsnprintf(tmpbuf, "%s <%s+%s> %s", 
-                      string_addr.c_str(), func.c_str(),
-                      offset_from_func.c_str(), inst.c_str());
+    // functions with this name don't support function disassembly from address or file/line combos
+    // found this type of function in file: /lib64/ld-linux-x86-64.so.2
+    if (frame.func == "??")
+    {
+        gui.line_disasm.clear();
+        gui.line_disasm_source.clear();
+        return;
+    }
 
-            add.addr = ParseHex(string_addr);
-            add.text = tmpbuf;
-            gui.line_disasm.emplace_back(add);
+    const File &file = prog.files[frame.file_idx];
+    bool has_source = (GetLineCount(file) != 0);
+    if (!has_source)
+    {
+        if (!gdb.has_data_disassemble_option_a)
+        {
+            // operation not supported, bail early
+            gui.line_disasm.clear();
+            gui.line_disasm_source.clear();
+            return;
+        }
+        else 
+        {
+            // some frames don't have an associated file ex: _start function after returning from main
+            tsnprintf(tmpbuf, "-data-disassemble -a %s 0", // 0 = disasm only
+                      frame.func.c_str());
         }
     }
+    else
+    {
+        // -n -1 = disassemble all lines in the function its contained in
+        // 5 = source and disasm with opcodes
+        tsnprintf(tmpbuf, "-data-disassemble -f \"%s\" -l %zu -n -1 5",
+                  file.filename.c_str(), frame.line_idx + 1);
+    }
+
+    GDB_SendAsync(tmpbuf, [has_source](const Record &rec, bool)
+    {
+        ReadFunctionDisassembly(rec, has_source);
+        MarkStopPhase(StopPhase_Disassembly);
+    });
 }
 
 void RecurseSetNodeState(const Record &rec, size_t atom_idx, int state, String name)
@@ -1106,8 +1017,8 @@ void RecurseSetNodeState(const Record &rec, size_t atom_idx, int state, String n
     {
         size_t childoffset = parent.value.index + i;
         const RecordAtom &child = rec.atoms[childoffset];
-        String childname = name + String(rec.buf.c_str() + child.name.index,
-                                         child.name.length);
+        String childname = name + String(rec.buf.c_str() + child.name_index,
+                                         child.name_length);
         if (child.type == Atom_Array || child.type == Atom_Struct)
         {
             RecurseSetNodeState(rec, childoffset, state, childname);
@@ -1125,10 +1036,10 @@ void RecurseExpressionTreeNodes(const VarObj &var, size_t atom_idx,
     Assert(parent.type == Atom_Struct || parent.type == Atom_Array);
     Assert(parent.value.length > 0);
 
-    if (parent.name.length != 0)
+    if (parent.name_length != 0)
     {
-        tsnprintf(tmpbuf, "%.*s##%zu", (int)parent.name.length, 
-                  &src.buf[ parent.name.index ], atom_idx);
+        tsnprintf(tmpbuf, "%.*s##%zu", (int)parent.name_length, 
+                  &src.buf[ parent.name_index ], atom_idx);
     }
     else
     {
@@ -1156,8 +1067,8 @@ void RecurseExpressionTreeNodes(const VarObj &var, size_t atom_idx,
         }
         else if (iter.type == Atom_String)
         {
-            string_start_idx = (iter.name.index != 0)
-                ? iter.name.index : iter.value.index;
+            string_start_idx = (iter.name_index != 0)
+                ? iter.name_index : iter.value.index;
             break;
         }
     }
@@ -1209,10 +1120,10 @@ void RecurseExpressionTreeNodes(const VarObj &var, size_t atom_idx,
             {
                 ImGui::TableNextRow();
                 ImGui::TableNextColumn();
-                if (child.name.length > 0)
+                if (child.name_length > 0)
                 {
-                    ImGui::Text("%.*s", (int)child.name.length,
-                                &src.buf[ child.name.index ]);
+                    ImGui::Text("%.*s", (int)child.name_length,
+                                &src.buf[ child.name_index ]);
                 }
                 else
                 {
@@ -1222,9 +1133,9 @@ void RecurseExpressionTreeNodes(const VarObj &var, size_t atom_idx,
                 ImColor color = (var.expr_changed[i])
                     ? IM_COL32_WIN_RED
                     : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+                StringView value = GetAtomView(child, src);
                 ImGui::TableNextColumn();
-                ImGui::TextColored(color, "%.*s", (int)child.value.length, 
-                                   &src.buf[ child.value.index ]);
+                ImGui::TextColored(color, "%.*s", (int)value.size, value.data);
             }
 
             array_index++;
@@ -1234,55 +1145,163 @@ void RecurseExpressionTreeNodes(const VarObj &var, size_t atom_idx,
     }
     else if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
     {
-        String name = String(src.buf.c_str() + parent.name.index, 
-                             parent.name.length);
+        String name = String(src.buf.c_str() + parent.name_index, 
+                             parent.name_length);
         // TODO fix empty names RecurseSetNodeState(src, atom_idx, 1, name);
     }
 
     if (close_after)
     {
-        String name = String(src.buf.c_str() + parent.name.index,
-                             parent.name.length);
+        String name = String(src.buf.c_str() + parent.name_index,
+                             parent.name_length);
         // TODO fix empty names RecurseSetNodeState(src, atom_idx, 0, name);
     }
 }
 
 Breakpoint ExtractBreakpoint(const Record &rec)
 {
+    static constexpr AtomPath BKPT_FULLNAME = "bkpt.fullname";
+    static constexpr AtomPath BKPT_NUMBER = "bkpt.number";
+    static constexpr AtomPath BKPT_ADDR = "bkpt.addr";
+    static constexpr AtomPath BKPT_ENABLED = "bkpt.enabled";
+    static constexpr AtomPath BKPT_LINE = "bkpt.line";
+    static constexpr AtomPath BKPT_WHAT = "bkpt.what";
+    static constexpr AtomPath BKPT_COND = "bkpt.cond";
+    static_assert(BKPT_FULLNAME.num_segments == 2 && 
+                  BKPT_FULLNAME.segments[1].hash == HashAtomName("fullname", 8), 
+                  "AtomPath should be hashed at compile time");
+
     Breakpoint result = {};
-    String filename = GDB_ExtractValue("bkpt.fullname", rec);
-    result.file_idx = FindOrCreateFile(filename);
-    result.number = GDB_ExtractInt("bkpt.number", rec);
-    result.addr = ParseHex(GDB_ExtractValue("bkpt.addr", rec));
-    result.enabled = ("y" == GDB_ExtractValue("bkpt.enabled", rec));
+    result.file_idx = FindOrCreateFile( GDB_ExtractView(BKPT_FULLNAME, rec) );
+    result.number = GDB_ExtractInt(BKPT_NUMBER, rec);
+    result.addr = ParseHex(GDB_ExtractView(BKPT_ADDR, rec));
+    result.enabled = ("y" == GDB_ExtractView(BKPT_ENABLED, rec));
 
-    int line = GDB_ExtractInt("bkpt.line", rec);
+    int line = GDB_ExtractInt(BKPT_LINE, rec);
     result.line_idx = (line > 0) ? (size_t)(line - 1) : BAD_INDEX;
 
-    String what = GDB_ExtractValue("bkpt.what", rec);
-    if (what != "")
+    StringView what = GDB_ExtractView(BKPT_WHAT, rec);
+    if (what.size > 0)
     {
-        result.cond = "watch " + what;
+        result.cond = "watch " + ToString(what);
     }
     else
     {
-        result.cond = GDB_ExtractValue("bkpt.cond", rec);
+        result.cond = GDB_ExtractValue(BKPT_COND, rec);
     }
 
     return result;
 }
 
-void QueryFrame(bool force_clear_locals)
+// prog.breakpoints lookups, add/remove/change every breakpoint through
+// the functions below so the indexes stay in sync
+static void LinkBreakpoint(const Breakpoint &b)
 {
-    // query the prog.frame_idx for locals, callstack, globals
-    Record rec;
-    char tmpbuf[4096];
-    gui.jump_type = Jump_Stopped;
-    QueryWatchlist();
+    prog.breakpoint_addrs.emplace(b.addr, b.number);
+    if (b.file_idx < prog.files.size() && b.line_idx != BAD_INDEX)
+    {
+        BreakpointLine &line = prog.files[b.file_idx].breakpoint_lines[b.line_idx];
+        line.count++;
+        if (!b.enabled)
+            line.num_disabled++;
+    }
+}
 
-    tsnprintf(tmpbuf, "-stack-list-frames --thread %d", GetActiveThreadID());
-    GDB_SendBlocking(tmpbuf, rec);
-    const RecordAtom *callstack = GDB_ExtractAtom("stack", rec);
+static void UnlinkBreakpoint(const Breakpoint &b)
+{
+    auto range = prog.breakpoint_addrs.equal_range(b.addr);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        if (it->second == b.number)
+        {
+            prog.breakpoint_addrs.erase(it);
+            break;
+        }
+    }
+
+    if (b.file_idx < prog.files.size() && b.line_idx != BAD_INDEX)
+    {
+        HashMap<size_t, BreakpointLine> &lines = prog.files[b.file_idx].breakpoint_lines;
+        auto it = lines.find(b.line_idx);
+        if (it != lines.end())
+        {
+            it->second.count--;
+            if (!b.enabled)
+                it->second.num_disabled--;
+            if (it->second.count == 0)
+                lines.erase(it);
+        }
+    }
+}
+
+static Breakpoint *FindBreakpoint(size_t number)
+{
+    auto it = prog.breakpoint_numbers.find(number);
+    return (it != prog.breakpoint_numbers.end()) ? &prog.breakpoints[it->second] : NULL;
+}
+
+// add a new breakpoint or replace the one with the same number
+static void SetBreakpoint(const Breakpoint &b)
+{
+    Breakpoint *existing = FindBreakpoint(b.number);
+    if (existing != NULL)
+    {
+        UnlinkBreakpoint(*existing);
+        *existing = b;
+    }
+    else
+    {
+        prog.breakpoint_numbers[b.number] = prog.breakpoints.size();
+        prog.breakpoints.push_back(b);
+    }
+    LinkBreakpoint(b);
+}
+
+static void RemoveBreakpoint(size_t number)
+{
+    auto it = prog.breakpoint_numbers.find(number);
+    if (it == prog.breakpoint_numbers.end())
+        return;
+
+    size_t idx = it->second;
+    UnlinkBreakpoint(prog.breakpoints[idx]);
+    prog.breakpoint_numbers.erase(it);
+
+    // swap remove, only the last breakpoint changes index
+    if (idx + 1 != prog.breakpoints.size())
+    {
+        prog.breakpoints[idx] = std::move(prog.breakpoints.back());
+        prog.breakpoint_numbers[ prog.breakpoints[idx].number ] = idx;
+    }
+    prog.breakpoints.pop_back();
+}
+
+static void ClearBreakpoints()
+{
+    for (File &file : prog.files)
+        file.breakpoint_lines.clear();
+
+    prog.breakpoint_addrs.clear();
+    prog.breakpoint_numbers.clear();
+    prog.breakpoints.clear();
+}
+
+static void SetBreakpointEnabled(size_t number, bool enabled)
+{
+    Breakpoint *b = FindBreakpoint(number);
+    if (b != NULL && b->enabled != enabled)
+    {
+        UnlinkBreakpoint(*b);
+        b->enabled = enabled;
+        LinkBreakpoint(*b);
+    }
+}
+
+static void ReadStackFrames(const Record &rec, bool force_clear_locals)
+{
+    TRACE_SCOPE(trace, "QueryFrame stack");
+    static constexpr AtomPath STACK = "stack";
+    const RecordAtom *callstack = GDB_ExtractAtom(STACK, rec);
     if (callstack)
     {
         String arch = "";
@@ -1293,15 +1312,20 @@ void QueryFrame(bool force_clear_locals)
 
         for (const RecordAtom &level : GDB_IterChild(rec, callstack))
         {
+            static constexpr AtomPath LINE = "line";
+            static constexpr AtomPath ADDR = "addr";
+            static constexpr AtomPath FUNC = "func";
+            static constexpr AtomPath ARCH = "arch";
+            static constexpr AtomPath FULLNAME = "fullname";
+
             Frame add = {};
-            add.line_idx = (size_t)GDB_ExtractInt("line", level, rec) - 1;
-            add.addr = ParseHex( GDB_ExtractValue("addr", level, rec) );
-            add.func = GDB_ExtractValue("func", level, rec);
-            arch = GDB_ExtractValue("arch", level, rec);
+            add.line_idx = (size_t)GDB_ExtractInt(LINE, level, rec) - 1;
+            add.addr = ParseHex( GDB_ExtractView(ADDR, level, rec) );
+            add.func = GDB_ExtractValue(FUNC, level, rec);
+            arch = GDB_ExtractValue(ARCH, level, rec);
             stack_sig += add.func;
 
-            String fullpath = GDB_ExtractValue("fullname", level, rec);
-            add.file_idx = FindOrCreateFile(fullpath);
+            add.file_idx = FindOrCreateFile( GDB_ExtractView(FULLNAME, level, rec) );
 
             prog.frames.emplace_back(add);
         }
@@ -1314,8 +1338,7 @@ void QueryFrame(bool force_clear_locals)
             {
                 prog.file_idx = frame.file_idx;
                 File &file = prog.files[prog.file_idx];
-                if (file.lines.size() == 0)
-                    LoadFile(file);
+                UseFile(prog.source_cache, prog.files, prog.file_idx);
 
                 // check to see if the source file is newer than executable
                 // same as what GDB does in source-cache.c
@@ -1381,31 +1404,37 @@ void QueryFrame(bool force_clear_locals)
 
                 String str = StringPrintf("-var-create " GLOBAL_NAME_PREFIX "%s @ $%s", 
                                           registers[i], registers[i]);
-                if (GDB_SendBlocking(str.c_str(), rec))
+                const char *regname = registers[i];
+                GDB_SendAsync(str.c_str(), [regname](const Record &var_rec, bool ok)
                 {
-                    VarObj add = CreateVarObj(registers[i], GDB_ExtractValue("value", rec));
-                    prog.global_vars.emplace_back(add);
-                }
+                    if (ok)
+                    {
+                        static constexpr AtomPath VALUE = "value";
+                        VarObj add = CreateVarObj(regname, GDB_ExtractValue(VALUE, var_rec));
+                        prog.global_vars.emplace_back(add);
+                    }
+                });
             }
         }
     }
+}
 
-    // get local variables for this stack frame
-    // prog.local_vars not actually GDB variable objects,
-    // problems with aggregates displaying updates
-
-    tsnprintf(tmpbuf, "-stack-list-variables --frame %zu --thread %d --all-values", prog.frame_idx, GetActiveThreadID());
-    GDB_SendBlocking(tmpbuf, rec);
+static void ReadLocals(const Record &rec)
+{
+    TRACE_SCOPE(trace, "QueryFrame locals");
     for (VarObj &local : prog.local_vars) local.changed = false;
 
-    const RecordAtom *vars = GDB_ExtractAtom("variables", rec);
+    static constexpr AtomPath VARIABLES = "variables";
+    const RecordAtom *vars = GDB_ExtractAtom(VARIABLES, rec);
     size_t start_locals_length = prog.local_vars.size();
     Vector<bool> var_found( start_locals_length );
 
     for (const RecordAtom &child : GDB_IterChild(rec, vars))
     {
-        VarObj incoming = CreateVarObj(GDB_ExtractValue("name", child, rec),
-                                       GDB_ExtractValue("value", child, rec));
+        static constexpr AtomPath NAME = "name";
+        static constexpr AtomPath VALUE = "value";
+        VarObj incoming = CreateVarObj(GDB_ExtractValue(NAME, child, rec),
+                                       GDB_ExtractValue(VALUE, child, rec));
 
         bool found = false;
         for (size_t i = start_locals_length - 1; i < start_locals_length; i--)
@@ -1436,16 +1465,21 @@ void QueryFrame(bool force_clear_locals)
             prog.local_vars.erase(prog.local_vars.begin() + i,
                                   prog.local_vars.begin() + i + 1);
     }
+}
 
-    // update global values, just registers right now
-    GDB_SendBlocking("-var-update --all-values *", rec);
-    const RecordAtom *changelist = GDB_ExtractAtom("changelist", rec);
+static void ReadGlobals(const Record &rec)
+{
+    TRACE_SCOPE(trace, "QueryFrame globals");
+    static constexpr AtomPath CHANGELIST = "changelist";
+    const RecordAtom *changelist = GDB_ExtractAtom(CHANGELIST, rec);
     for (VarObj &global : prog.global_vars) global.changed = false;
 
     for (const RecordAtom &iter : GDB_IterChild(rec, changelist))
     {
-        VarObj incoming = CreateVarObj(GDB_ExtractValue("name", iter, rec),
-                                       GDB_ExtractValue("value", iter, rec));
+        static constexpr AtomPath NAME = "name";
+        static constexpr AtomPath VALUE = "value";
+        VarObj incoming = CreateVarObj(GDB_ExtractValue(NAME, iter, rec),
+                                       GDB_ExtractValue(VALUE, iter, rec));
 
         const char *srcname = incoming.name.c_str();
         const char *namestart = strstr(srcname, GLOBAL_NAME_PREFIX);
@@ -1468,257 +1502,316 @@ void QueryFrame(bool force_clear_locals)
     }
 }
 
-bool IsValidLine(size_t line_idx, size_t file_idx)
+void QueryFrame(bool force_clear_locals)
 {
-    bool result = false;
-    if (file_idx < prog.files.size())
+    // query the prog.frame_idx for locals, callstack, globals
+    // all of these are in flight at once, GDB answers them in order so
+    // the stack frames are read before the locals
+    char tmpbuf[4096];
+    gui.jump_type = Jump_Stopped;
+    QueryWatchlist();
+
+    tsnprintf(tmpbuf, "-stack-list-frames --thread %d", GetActiveThreadID());
+    GDB_SendAsync(tmpbuf, [force_clear_locals](const Record &rec, bool)
     {
-        if (line_idx < prog.files[file_idx].lines.size())
+        ReadStackFrames(rec, force_clear_locals);
+        MarkStopPhase(StopPhase_Stack);
+    });
+
+    // get local variables for this stack frame
+    // prog.local_vars not actually GDB variable objects,
+    // problems with aggregates displaying updates
+    tsnprintf(tmpbuf, "-stack-list-variables --frame %zu --thread %d --all-values", prog.frame_idx, GetActiveThreadID());
+    GDB_SendAsync(tmpbuf, [](const Record &rec, bool)
+    {
+        ReadLocals(rec);
+        MarkStopPhase(StopPhase_Locals);
+    });
+
+    // update global values, just registers right now
+    GDB_SendAsync("-var-update --all-values *", [](const Record &rec, bool)
+    {
+        ReadGlobals(rec);
+        MarkStopPhase(StopPhase_VarUpdate);
+    });
+}
+
+static void OnBreakpointCreated(const Record &rec)
+{
+    // breakpoints created from console ex: "b main.cpp:14"
+    SetBreakpoint(ExtractBreakpoint(rec));
+}
+
+static void OnBreakpointModified(const Record &rec)
+{
+    Breakpoint b = ExtractBreakpoint(rec);
+    if (FindBreakpoint(b.number) != NULL)
+        SetBreakpoint(b);
+}
+
+static void OnBreakpointDeleted(const Record &rec)
+{
+    // breakpoints deleted from console ex: "d 1"
+    static constexpr AtomPath ID = "id";
+    size_t id = (size_t)GDB_ExtractInt(ID, rec);
+    RemoveBreakpoint(id);
+}
+
+static void OnThreadGroupStarted(const Record &rec)
+{
+    static constexpr AtomPath PID = "pid";
+    prog.inferior_process = (pid_t)GDB_ExtractInt(PID, rec);
+}
+
+static void OnThreadGroupExited(const Record &rec)
+{
+    static constexpr AtomPath ID = "id";
+    StringView group_id = GDB_ExtractView(ID, rec);
+    for (size_t end = prog.threads.size(); end > 0; end--)
+    {
+        size_t t = end - 1;
+        if (prog.threads[t].group_id.c_str() == group_id)
         {
-            result = true;
+            prog.threads.erase(prog.threads.begin() + t,
+                               prog.threads.begin() + t + 1);
+            break;
         }
     }
-
-    return result;
 }
 
-String GetLine(const File &f, size_t line_idx)
+static void OnThreadSelected(const Record &rec)
 {
-    String result;
-    if (line_idx < f.lines.size())
+    static constexpr AtomPath ID = "id";
+    static constexpr AtomPath FRAME_LEVEL = "frame.level";
+    int tid = GDB_ExtractInt(ID, rec);
+    for (size_t t = 0; t < prog.threads.size(); t++)
+        if (prog.threads[t].id == tid)
+            prog.thread_idx = t; 
+
+    // user jumped to a new thread/frame from the console window
+    if (!prog.running)
     {
-        size_t num_chars = 0;
-        if (line_idx == (f.lines.size() - 1))
+        size_t index = (size_t)GDB_ExtractInt(FRAME_LEVEL, rec);
+        if (index < prog.frames.size())
         {
-            num_chars = f.data.size() - f.lines[line_idx];
+            prog.frame_idx = index;
+            QueryFrame(true);
         }
-        else
+    }
+}
+
+static void OnThreadCreated(const Record &rec)
+{
+    static constexpr AtomPath ID = "id";
+    static constexpr AtomPath GROUP_ID = "group-id";
+    Thread t = {};
+    t.id = GDB_ExtractInt(ID, rec);
+    t.group_id = GDB_ExtractValue(GROUP_ID, rec);
+    t.focused = true;
+
+    if (t.id != 0 && t.group_id != "")
+        prog.threads.push_back(t);
+}
+
+static void OnThreadExited(const Record &rec)
+{
+    static constexpr AtomPath ID = "id";
+    static constexpr AtomPath GROUP_ID = "group-id";
+    int id = GDB_ExtractInt(ID, rec);
+    StringView group_id = GDB_ExtractView(GROUP_ID, rec);
+    for (size_t t = 0; t < prog.threads.size(); t++)
+    {
+        if (prog.threads[t].id == id &&
+            prog.threads[t].group_id.c_str() == group_id)
         {
-            num_chars = f.lines[line_idx + 1] - f.lines[line_idx];
+            prog.threads.erase(prog.threads.begin() + t,
+                               prog.threads.begin() + t + 1);
+            break;
         }
-
-        result.assign(f.data.data() + f.lines[line_idx], num_chars);
     }
+}
 
-    return result;
+static void OnRunning(const Record &rec)
+{
+    static constexpr AtomPath THREAD_ID = "thread-id";
+    prog.running = true;
+    StringView thread = GDB_ExtractView(THREAD_ID, rec);
+    if (thread == "all")
+    {
+        for (Thread &t : prog.threads)
+            t.running = true;
+    }
+    else
+    {
+        int tid = GDB_ExtractInt(THREAD_ID, rec);
+        for (Thread &t : prog.threads)
+            if (t.id == tid)
+                t.running = true;
+    }
 }
- 
-void Draw()
+
+static void OnStopped(const Record &rec)
 {
-    Record rec;
-    char tmpbuf[4096];
-    const ImVec2 MIN_WINSIZE = ImVec2(350.0f, 250.0f);
-    const ImGuiTableFlags TABLE_FLAGS = ImGuiTableFlags_ScrollX |
-                                        ImGuiTableFlags_ScrollY |
-                                        ImGuiTableFlags_Resizable |
-                                        ImGuiTableFlags_BordersInner;
+    static constexpr AtomPath REASON = "reason";
+    static constexpr AtomPath THREAD_ID = "thread-id";
+    static constexpr AtomPath STOPPED_THREADS = "stopped-threads";
 
-    // check for new blocks
-    int recv_block_semvalue = 0;
-    sem_getvalue(gdb.recv_block, &recv_block_semvalue);
-    if (recv_block_semvalue > 0)
+    // jump to the stopped thread if the current index is running
+    bool jump_to_thread = true;
+    if (prog.thread_idx < prog.threads.size())
     {
-        GDB_GrabBlockData();
-        sem_wait(gdb.recv_block);
+        bool no_lines_shown = false;
+        if (prog.frame_idx < prog.frames.size())
+        {
+            size_t idx = prog.frames[prog.frame_idx].file_idx;
+            if (idx < prog.files.size() && prog.files[idx].lines.size() == 0)
+                no_lines_shown = true;
+        }
+
+        if (!prog.threads[prog.thread_idx].running && !no_lines_shown)
+            jump_to_thread = false;
     }
 
-    // process and clear all records found
-    size_t last_num_recs = prog.num_recs;
-    for (size_t i = 0; i < last_num_recs; i++)
+    prog.running = false;
+    String reason = GDB_ExtractValue(REASON, rec);
+    int tid = GDB_ExtractInt(THREAD_ID, rec);
+
+    if (stop_bench.num_stops != 0)
     {
-        RecordHolder &iter = prog.read_recs[i];
-        if (!iter.parsed)
+        uint64_t now = GetNanoseconds();
+        memset(stop_bench.phase_ns, 0, sizeof(stop_bench.phase_ns));
+        stop_bench.phase_ns[StopPhase_Gdb] = now - stop_bench.sent_ns;
+        stop_bench.stopped_ns = now;
+    }
+
+    // wonky: sometimes it's stopped-threads="all", and sometimes it's stopped-threads=["all"]
+    bool stopped_all = false;
+    const RecordAtom *stopped_threads = GDB_ExtractAtom(STOPPED_THREADS, rec);
+    if (stopped_threads != NULL)
+    {
+        if (stopped_threads->type == Atom_String)
         {
-            iter.parsed = true;
-            Record &parse_rec = iter.rec;
-            const char *src = parse_rec.buf.c_str();
+            stopped_all = ("all" == GetAtomView(*stopped_threads, rec));
+        }
+        else if (stopped_threads->type == Atom_Array)
+        {
+            for (const RecordAtom &stopped : GDB_IterChild(rec, stopped_threads))
+                stopped_all |= ("all" == GetAtomView(stopped, rec));
+        }
+    }
 
-            const char *comma = (char *)memchr(src, ',', parse_rec.buf.size());
-            if (comma == NULL) 
-                comma = &src[ parse_rec.buf.size() ];
+    for (size_t t = 0; t < prog.threads.size(); t++)
+    {
+        if (prog.threads[t].id == tid || stopped_all)
+            prog.threads[t].running = false;
 
-            // skip MI prefix char
-            String record_action;
-            char prefix = '\0';
-            if (parse_rec.buf.size() > 0)
-            {
-                prefix = parse_rec.buf[0];
-                record_action = GDB_GetRecordAction(parse_rec);
-            }
+        if (prog.threads[t].id == tid && jump_to_thread)
+        {
+            prog.thread_idx = t; 
+            prog.frame_idx = 0;
+        }
+    }
 
-            if (prefix == PREFIX_ASYNC0)
-            {
-                if (record_action == "breakpoint-created")
-                {
-                    // breakpoints created from console ex: "b main.cpp:14"
-                    prog.breakpoints.push_back(ExtractBreakpoint(parse_rec));
-                }
-                else if (record_action == "breakpoint-modified")
-                {
-                    Breakpoint b = ExtractBreakpoint(parse_rec);
-                    for (Breakpoint &bkpt : prog.breakpoints)
-                    {
-                        if (bkpt.number == b.number)
-                        {
-                            bkpt = b; 
-                            break;
-                        }
-                    }
-                }
-                else if (record_action == "breakpoint-deleted")
-                {
-                    // breakpoints deleted from console ex: "d 1"
-                    size_t id = (size_t)GDB_ExtractInt("id", parse_rec);
-                    auto &bpts = prog.breakpoints;
-                    for (size_t b = 0; b < bpts.size(); b++)
-                    {
-                        if (bpts[b].number == id)
-                        {
-                            bpts.erase(bpts.begin() + b, 
-                                       bpts.begin() + b + 1);
-                            break;
-                        }
-                    }
-                }
-                else if (record_action == "thread-group-started")
-                {
-                    prog.inferior_process = (pid_t)GDB_ExtractInt("pid", parse_rec);
-                }
-                else if (record_action == "thread-group-exited")
-                {
-                    String group_id = GDB_ExtractValue("id", parse_rec);
-                    for (size_t end = prog.threads.size(); end > 0; end--)
-                    {
-                        size_t t = end - 1;
-                        if (prog.threads[t].group_id == group_id)
-                        {
-                            prog.threads.erase(prog.threads.begin() + t,
-                                               prog.threads.begin() + t + 1);
-                            break;
-                        }
-                    }
-                }
-                else if (record_action == "thread-selected")
-                {
-                    int tid = GDB_ExtractInt("id", parse_rec);
-                    for (size_t t = 0; t < prog.threads.size(); t++)
-                        if (prog.threads[t].id == tid)
-                            prog.thread_idx = t; 
+    if ( (NULL != strstr(reason.c_str(), "exited")) )
+    {
+        ResetProgramState();
+    }
+    else
+    {
+        prog.started = true;
+        if (jump_to_thread)
+            QueryFrame(false);
+    }
+}
 
-                    // user jumped to a new thread/frame from the console window
-                    if (!prog.running)
-                    {
-                        size_t index = (size_t)GDB_ExtractInt("frame.level", parse_rec);
-                        if (index < prog.frames.size())
-                        {
-                            prog.frame_idx = index;
-                            QueryFrame(true);
-                        }
-                    }
-                }
-                else if (record_action == "thread-created")
-                {
-                    Thread t = {};
-                    t.id = GDB_ExtractInt("id", parse_rec);
-                    t.group_id = GDB_ExtractValue("group-id", parse_rec);
-                    t.focused = true;
+struct RecordHandler
+{
+    char prefix;
+    void (*callback)(const Record &rec);
+};
 
-                    if (t.id != 0 && t.group_id != "")
-                        prog.threads.push_back(t);
-                }
-                else if (record_action == "thread-exited")
-                {
-                    int id = GDB_ExtractInt("id", parse_rec);
-                    String group_id = GDB_ExtractValue("group-id", parse_rec);
-                    for (size_t t = 0; t < prog.threads.size(); t++)
-                    {
-                        if (prog.threads[t].id == id &&
-                            prog.threads[t].group_id == group_id)
-                        {
-                            prog.threads.erase(prog.threads.begin() + t,
-                                               prog.threads.begin() + t + 1);
-                            break;
-                        }
-                    }
-                }
-            }
-            else if (record_action == "running")
-            {
-                prog.running = true;
-                String thread = GDB_ExtractValue("thread-id", parse_rec);
-                if (thread == "all")
-                {
-                    for (Thread &t : prog.threads)
-                        t.running = true;
-                }
-                else
-                {
-                    int tid = atoi(thread.c_str());
-                    for (Thread &t : prog.threads)
-                        if (t.id == tid)
-                            t.running = true;
-                }
-            }
-            else if (record_action == "stopped")
-            {
-                // jump to the stopped thread if the current index is running
-                bool jump_to_thread = true;
-                if (prog.thread_idx < prog.threads.size())
-                {
-                    bool no_lines_shown = false;
-                    if (prog.frame_idx < prog.frames.size())
-                    {
-                        size_t idx = prog.frames[prog.frame_idx].file_idx;
-                        if (idx < prog.files.size() && prog.files[idx].lines.size() == 0)
-                            no_lines_shown = true;
-                    }
+static const RecordHandler &GetRecordHandler(RecordAction action)
+{
+    struct HandlerTable
+    {
+        RecordHandler handlers[Action_Count];
+    };
+
+    static const HandlerTable table = []() -> HandlerTable
+    {
+        HandlerTable result = {};
+        result.handlers[Action_BreakpointCreated] = { PREFIX_ASYNC0, OnBreakpointCreated };
+        result.handlers[Action_BreakpointModified] = { PREFIX_ASYNC0, OnBreakpointModified };
+        result.handlers[Action_BreakpointDeleted] = { PREFIX_ASYNC0, OnBreakpointDeleted };
+        result.handlers[Action_ThreadGroupStarted] = { PREFIX_ASYNC0, OnThreadGroupStarted };
+        result.handlers[Action_ThreadGroupExited] = { PREFIX_ASYNC0, OnThreadGroupExited };
+        result.handlers[Action_ThreadSelected] = { PREFIX_ASYNC0, OnThreadSelected };
+        result.handlers[Action_ThreadCreated] = { PREFIX_ASYNC0, OnThreadCreated };
+        result.handlers[Action_ThreadExited] = { PREFIX_ASYNC0, OnThreadExited };
+        result.handlers[Action_Running] = { PREFIX_ASYNC1, OnRunning };
+        result.handlers[Action_Stopped] = { PREFIX_ASYNC1, OnStopped };
+        return result;
+    }();
+
+    Assert(action < Action_Count);
+    return table.handlers[action];
+}
+
+void Draw()
+{
+    Record rec;
+    char tmpbuf[4096];
+    const ImVec2 MIN_WINSIZE = ImVec2(350.0f, 250.0f);
+    const ImGuiTableFlags TABLE_FLAGS = ImGuiTableFlags_ScrollX |
+                                        ImGuiTableFlags_ScrollY |
+                                        ImGuiTableFlags_Resizable |
+                                        ImGuiTableFlags_BordersInner;
 
-                    if (!prog.threads[prog.thread_idx].running && !no_lines_shown)
-                        jump_to_thread = false;
-                }
+    // check for new blocks
+    if (RingCount(gdb.from_gdb) > 0)
+        GDB_GrabBlockData();
 
-                prog.running = false;
-                String reason = GDB_ExtractValue("reason", parse_rec);
-                int tid = GDB_ExtractInt("thread-id", parse_rec);
+    // results for commands sent in earlier frames
+    uint64_t async_deadline_ns = GDB_DispatchAsync();
+    if (async_deadline_ns != 0)
+    {
+        // wake up to time out whatever is still waiting
+        uint64_t now_ns = GetNanoseconds();
+        RequestRedraw((async_deadline_ns > now_ns) ? (async_deadline_ns - now_ns) / 1e9 : 0.0);
+    }
 
-                // wonky: sometimes it's stopped-threads="all", and sometimes it's stopped-threads=["all"]
-                bool stopped_all = false;
-                const RecordAtom *stopped_threads = GDB_ExtractAtom("stopped-threads", parse_rec);
-                if (stopped_threads != NULL)
-                {
-                    if (stopped_threads->type == Atom_String)
-                    {
-                        stopped_all = ("all" == GetAtomString(stopped_threads->value, parse_rec));
-                    }
-                    else if (stopped_threads->type == Atom_Array)
-                    {
-                        for (const RecordAtom &stopped : GDB_IterChild(rec, stopped_threads))
-                            stopped_all |= ("all" == GetAtomString(stopped.value, rec));
-                    }
-                }
+    {
+        // inferior stdout since the last frame, swapped out to keep the lock short
+        static String output;
+        pthread_mutex_lock(&inferior_output_lock);
+        output.swap(inferior_output);
+        pthread_mutex_unlock(&inferior_output_lock);
 
-                for (size_t t = 0; t < prog.threads.size(); t++)
-                {
-                    if (prog.threads[t].id == tid || stopped_all)
-                        prog.threads[t].running = false;
+        if (output.size() > 0)
+        {
+            WriteToConsoleBuffer(output.data(), output.size());
+            output.clear();
+        }
 
-                    if (prog.threads[t].id == tid && jump_to_thread)
-                    {
-                        prog.thread_idx = t; 
-                        prog.frame_idx = 0;
-                    }
-                }
+        // once a frame instead of on every console write
+        ConsoleFlush(prog.log);
+        TrimSourceCache(prog.source_cache, prog.files, prog.file_idx);
+    }
 
-                if ( (NULL != strstr(reason.c_str(), "exited")) )
-                {
-                    ResetProgramState();
-                }
-                else
-                {
-                    prog.started = true;
-                    if (jump_to_thread)
-                        QueryFrame(false);
-                }
+    // process and clear all records found
+    size_t last_num_recs = prog.num_recs;
+    for (size_t i = 0; i < last_num_recs && i < prog.num_recs; i++)
+    {
+        RecordHolder &iter = prog.read_recs[i];
+        if (!iter.parsed)
+        {
+            iter.parsed = true;
+            const Record &parse_rec = iter.rec;
+            const RecordHandler &handler = GetRecordHandler(parse_rec.action);
+            if (handler.callback != NULL && parse_rec.buf.size() > 0 &&
+                parse_rec.buf[0] == handler.prefix)
+            {
+                handler.callback(parse_rec);
             }
         }
     }
@@ -1755,8 +1848,8 @@ void Draw()
                 {
                     // always reload the file on clicking open
                     size_t idx = FindOrCreateFile(ctx.path.c_str());
-                    prog.files[idx].lines.clear();
-                    if (LoadFile(prog.files[idx]))
+                    UnloadFile(prog.files[idx]);
+                    if (UseFile(prog.source_cache, prog.files, idx))
                     {
                         prog.file_idx = idx;
                         gui.jump_type = Jump_Goto;
@@ -1927,6 +2020,7 @@ void Draw()
             ImGui::MenuItem("Breakpoints##Checkbox", "", &gui.show_breakpoints);
             ImGui::MenuItem("Threads##Checkbox", "", &gui.show_threads);
             ImGui::MenuItem("Directory Viewer##Checkbox", "", &gui.show_directory_viewer);
+            ImGui::MenuItem("MI Traffic##Checkbox", "", &gui.show_mi_traffic);
 
             ImGui::EndMenu();
         }
@@ -1945,12 +2039,13 @@ void Draw()
                 show_register_window = true;
                 all_registers.clear();
                 GDB_SendBlocking("-data-list-register-names", rec);
-                const RecordAtom *regs = GDB_ExtractAtom("register-names", rec);
+                static constexpr AtomPath REGISTER_NAMES = "register-names";
+                const RecordAtom *regs = GDB_ExtractAtom(REGISTER_NAMES, rec);
 
                 for (const RecordAtom &reg : GDB_IterChild(rec, regs))
                 {
                     RegisterName add = {};
-                    add.text = GetAtomString(reg.value, rec);
+                    add.text = GetAtomString(reg, rec);
                     if (add.text != "") 
                     {
                         String to_find = GLOBAL_NAME_PREFIX + add.text;
@@ -2101,7 +2196,8 @@ void Draw()
                                   reg.text.c_str(), reg.text.c_str());
                         GDB_SendBlocking(tmpbuf, rec);
 
-                        VarObj add = CreateVarObj(reg.text, GDB_ExtractValue("value", rec));
+                        static constexpr AtomPath VALUE = "value";
+                        VarObj add = CreateVarObj(reg.text, GDB_ExtractValue(VALUE, rec));
                         prog.global_vars.emplace_back(add);
                     }
                     else
@@ -2159,6 +2255,14 @@ void Draw()
 
     if (gui.show_source) 
     {
+        uint64_t window_start_ns = GetNanoseconds();
+
+        // load the shown file again once it changes on disk, a truncated
+        // mapping reads zeros from the SIGBUS handler until then. every map
+        // read (search, goto, lines, disassembly source) is of this file
+        if (prog.file_idx < prog.files.size() && IsFileStale(prog.files[prog.file_idx]))
+            UseFile(prog.source_cache, prog.files, prog.file_idx);
+
         float saved_frame_border_size = ImGui::GetStyle().FrameBorderSize;
         ImGui::GetStyle().FrameBorderSize = 0.0f; // disable line border around breakpoints
         ImGui::PushFont(gui.source_font);
@@ -2224,7 +2328,9 @@ void Draw()
 
                 if ( ImGui::InputInt("##goto_line", &goto_line_idx, 1, 1, ImGuiInputTextFlags_EnterReturnsTrue) )    
                 {
-                    size_t linecount = prog.files[prog.file_idx].lines.size();
+                    File &goto_file = prog.files[prog.file_idx];
+                    IndexFileLines(goto_file, SIZE_MAX);
+                    size_t linecount = GetLineCount(goto_file);
                     if (goto_line_idx < 0) goto_line_idx = 0;
                     if ((size_t)goto_line_idx >= linecount) goto_line_idx = (linecount > 0) ? linecount - 1 : 0;
                     goto_line_open = false;
@@ -2247,7 +2353,8 @@ void Draw()
             if (prog.file_idx < prog.files.size())
             {
                 size_t dir = 1;
-                const File &this_file = prog.files[prog.file_idx];
+                File &this_file = prog.files[prog.file_idx];
+                IndexFileLines(this_file, SIZE_MAX);
 
                 if ( IsKeyPressed(ImGuiKey_N) &&
                      !ImGui::GetIO().WantCaptureKeyboard)
@@ -2258,7 +2365,7 @@ void Draw()
 
                     // advance search by skipping the previous match
                     gui.source_found_line_idx += dir;
-                    size_t linesize = this_file.lines.size();
+                    size_t linesize = GetLineCount(this_file);
                     if (gui.source_found_line_idx > linesize)   // wrap around
                         gui.source_found_line_idx = linesize - 1;
 
@@ -2268,10 +2375,11 @@ void Draw()
                 bool wraparound = false;
                 gui.source_found_line = false;
                 for (size_t i = gui.source_found_line_idx; 
-                     i < this_file.lines.size(); i += dir)
+                     i < GetLineCount(this_file); i += dir)
                 {
-                    const String &line = GetLine(this_file, i);
-                    if ( NULL != strstr(line.c_str(), gui.source_search_keyword) )
+                    StringView line = GetLine(this_file, i);
+                    if ( NULL != memmem(line.data, line.size, gui.source_search_keyword, 
+                                        strlen(gui.source_search_keyword)) )
                     {
                         gui.source_found_line = true;
                         gui.jump_type = Jump_Search;
@@ -2279,10 +2387,10 @@ void Draw()
                         break;
                     }
 
-                    if (!wraparound && i + dir >= this_file.lines.size())
+                    if (!wraparound && i + dir >= GetLineCount(this_file))
                     {
                         // continue searching at the other end of the array
-                        i = (dir == 1) ? 0 : this_file.lines.size() - 1;
+                        i = (dir == 1) ? 0 : GetLineCount(this_file) - 1;
                         wraparound = true;
                     }
                 }
@@ -2295,21 +2403,34 @@ void Draw()
 
         if (prog.file_idx < prog.files.size() && prog.files[prog.file_idx].lines.size() > 0)
         {
-            const File &file = prog.files[ prog.file_idx ];
+            File &file = prog.files[ prog.file_idx ];
 
-            // draw radio button and line offscreen to get the line size
-            // TODO: how to do this without drawing offscreen
-            float start_curpos_y = ImGui::GetCursorPosY();
-            ImGui::SetCursorPosY(-100);
-            float ystartoffscreen = ImGui::GetCursorPosY();
-            ImGui::RadioButton("##MeasureRadioHeight", false); ImGui::SameLine(); ImGui::Text("MeasureText");
-            float lineheight = ImGui::GetCursorPosY() - ystartoffscreen;
+            // finish the line index a step per frame after LoadFile did the first screen
+            if (IndexFileLines(file, FILE_INDEX_STEP_SIZE))
+                RequestRedraw();
+
+            // pixel sizes only change with the font or a longer line from the index
+            if (file.metrics_font_size != ImGui::GetFontSize() ||
+                file.metrics_longest_line_idx != file.longest_line_idx)
+            {
+                StringView longest = GetLine(file, file.longest_line_idx);
+                file.metrics_font_size = ImGui::GetFontSize();
+                file.metrics_longest_line_idx = file.longest_line_idx;
+                file.longest_line_width = ImGui::CalcTextSize(longest.data, longest.data + longest.size).x;
+
+                // each row is a radio button then text on the same line
+                file.line_height = ImGui::GetFrameHeightWithSpacing();
+            }
+
+            float lineheight = file.line_height;
             size_t perscreen = ceilf(ImGui::GetWindowHeight() / lineheight) + 1;
+            static String line_scratch;
 
             // set the max horizontal scrollbar size
-            String longest = GetLine(file, file.longest_line_idx);
+            float start_curpos_y = ImGui::GetCursorPosY();
             float start_curpos_x = ImGui::GetCursorPosX();
-            ImGui::SetCursorPosX(start_curpos_x + ImGui::CalcTextSize(longest.data(), longest.data() + longest.size()).x);
+            ImGui::SetCursorPosY(-100);
+            ImGui::SetCursorPosX(start_curpos_x + file.longest_line_width);
             ImGui::Text("foobarbaz");
 
             // reset the draw position
@@ -2361,10 +2482,10 @@ void Draw()
                         DefaultInvalid
                     }
 
-                    if (middle_idx < file.lines.size())
+                    if (IndexFileLinesTo(file, middle_idx))
                     {
                         size_t s = middle_idx - (perscreen / 2);
-                        if (s >= file.lines.size()) s = 0;
+                        if (s >= GetLineCount(file)) s = 0;
                         start_idx = s;
                         ImGui::SetScrollY(start_curpos_y + start_idx * lineheight); 
                     }
@@ -2372,27 +2493,25 @@ void Draw()
                     gui.jump_type = Jump_None;
                 }
 
-                size_t end_idx = GetMin(start_idx + perscreen, file.lines.size());
-                if (file.lines.size() > perscreen)
+                size_t end_idx = GetMin(start_idx + perscreen, GetLineCount(file));
+                if (GetLineCount(file) > perscreen)
                 {
                     // set scrollbar height
-                    ImGui::SetCursorPosY(start_curpos_y + file.lines.size() * lineheight); 
+                    ImGui::SetCursorPosY(start_curpos_y + GetLineCount(file) * lineheight); 
                 }
                 ImGui::SetCursorPosY(start_idx * lineheight + start_curpos_y);
 
                 for (size_t line_idx = start_idx; line_idx < end_idx; line_idx++)
                 {
-                    const String &line = GetLine(file, line_idx);
+                    StringView line = GetLine(file, line_idx);
 
                     bool is_breakpoint_on_line = false;
                     bool is_breakpoint_disabled = false;
-                    for (Breakpoint &iter : prog.breakpoints)
+                    auto bkpt_line = file.breakpoint_lines.find(line_idx);
+                    if (bkpt_line != file.breakpoint_lines.end())
                     {
-                        if (iter.line_idx == line_idx && iter.file_idx == prog.file_idx)
-                        {
-                            is_breakpoint_on_line = true;
-                            is_breakpoint_disabled |= !iter.enabled;
-                        }
+                        is_breakpoint_on_line = true;
+                        is_breakpoint_disabled = (bkpt_line->second.num_disabled > 0);
                     }
 
                     // start radio button style
@@ -2442,17 +2561,14 @@ void Draw()
                                         // change breakpoint state from disabled to enabled
                                         tsnprintf(tmpbuf, "-break-enable %zu", iter.number);
                                         if (GDB_SendBlocking(tmpbuf))
-                                            iter.enabled = true;
+                                            SetBreakpointEnabled(iter.number, true);
                                     }
                                     else
                                     {
                                         // remove breakpoint
                                         tsnprintf(tmpbuf, "-break-delete %zu", iter.number);
                                         if (GDB_SendBlocking(tmpbuf))
-                                        {
-                                            prog.breakpoints.erase(prog.breakpoints.begin() + b,
-                                                                   prog.breakpoints.begin() + b + 1);
-                                        }
+                                            RemoveBreakpoint(iter.number);
                                     }
 
                                     break;
@@ -2467,7 +2583,7 @@ void Draw()
                             if (GDB_SendBlocking(tmpbuf, rec))
                             {
                                 Breakpoint bkpt = ExtractBreakpoint(rec);
-                                prog.breakpoints.push_back(bkpt);
+                                SetBreakpoint(bkpt);
                                 const char *filename = prog.files[bkpt.file_idx].filename.c_str();
                                 const char *last_fwd = strrchr(filename, '/');
                                 if (last_fwd != NULL)
@@ -2485,32 +2601,32 @@ void Draw()
                     ImGui::PopStyleColor(4);
 
                     ImGui::SameLine();
-                    int line_written = tsnprintf(tmpbuf, "%-4zu %s", line_idx + 1, line.c_str());
-                    if (line_written >= (int)sizeof(tmpbuf))
-                        line_written = sizeof(tmpbuf) - 1;
+
+                    // format into scratch that keeps its capacity across frames
+                    int number_size = tsnprintf(tmpbuf, "%-4zu ", line_idx + 1);
+                    line_scratch.assign(tmpbuf, number_size);
+                    line_scratch.append(line.data, line.size);
 
                     ImVec2 textstart = ImGui::GetCursorPos();
-                    textstart.x += ImGui::CalcTextSize(tmpbuf, tmpbuf + line_written - line.size()).x; // skip line number for hover eval
+                    textstart.x += ImGui::CalcTextSize(tmpbuf, tmpbuf + number_size).x; // skip line number for hover eval
 
                     if (in_active_frame_file && line_idx == prog.frames[prog.frame_idx].line_idx)
                     {
                         // prevent any "##" text from being hidden
-                        if (line_written < (int)sizeof(tmpbuf))
-                            snprintf(tmpbuf + line_written, 
-                                     sizeof(tmpbuf) - line_written,
-                                     "##%zu", line_idx);
-                        ImGui::Selectable(tmpbuf, !prog.running);
+                        tsnprintf(tmpbuf, "##%zu", line_idx);
+                        line_scratch += tmpbuf;
+                        ImGui::Selectable(line_scratch.c_str(), !prog.running);
                     }
                     else
                     {
-                        if (gui.source_search_bar_open && line_idx == gui.source_found_line_idx)
-                        {
-                            ImGui::TextColored(ImColor(1.0f, 1.0f, 0.0f, 1.0f).Value, "%s", tmpbuf);
-                        }
-                        else
-                        {
-                            ImGui::Text("%s", tmpbuf);
-                        }
+                        bool is_found_line = gui.source_search_bar_open && line_idx == gui.source_found_line_idx;
+                        if (is_found_line)
+                            ImGui::PushStyleColor(ImGuiCol_Text, ImColor(1.0f, 1.0f, 0.0f, 1.0f).Value);
+
+                        ImGui::TextUnformatted(line_scratch.data(), line_scratch.data() + line_scratch.size());
+
+                        if (is_found_line)
+                            ImGui::PopStyleColor();
                     }
 
                     if (ImGui::IsItemHovered())
@@ -2523,15 +2639,15 @@ void Draw()
                         // enumerate words of the line
                         size_t word_idx = BAD_INDEX;
                         size_t delim_idx = BAD_INDEX;
-                        for (size_t char_idx = 0; char_idx < line.size(); char_idx++)
+                        for (size_t char_idx = 0; char_idx < line.size; char_idx++)
                         {
-                            char c = line[char_idx];
+                            char c = line.data[char_idx];
                             bool is_ident = (c >= 'a' && c <= 'z') || 
                                 (c >= 'A' && c <= 'Z') ||
                                 (word_idx != BAD_INDEX && (c >= '0' && c <= '9')) ||
                                 (c == '_');
 
-                            if (char_idx == line.size() - 1 && is_ident)
+                            if (char_idx == line.size - 1 && is_ident)
                             {
                                 // force a word on the last index
                                 if (word_idx == BAD_INDEX)
@@ -2548,8 +2664,8 @@ void Draw()
                                 {
                                     // we got a word delimited by spaces
                                     // calculate size and see if mouse is over it 
-                                    ImVec2 worddim = ImGui::CalcTextSize(line.data() + word_idx, 
-                                                                         line.data() + char_idx);
+                                    ImVec2 worddim = ImGui::CalcTextSize(line.data + word_idx, 
+                                                                         line.data + char_idx);
                                     if (relpos.x >= textstart.x && 
                                         relpos.x <= textstart.x + worddim.x && 
                                         prog.started)
@@ -2564,12 +2680,13 @@ void Draw()
                                         static double hover_time;
                                         static String hover_value;
                                         static bool hover_value_evaluated;
+                                        static uint32_t hover_id;
 
                                         // check to see if we should add the variable
                                         // to the watch variables
                                         if (ImGui::IsMouseClicked(ImGuiMouseButton_Right))
                                         {
-                                            String hover_string(line.data() + word_idx, char_idx - word_idx);
+                                            String hover_string(line.data + word_idx, char_idx - word_idx);
                                             VarObj add = CreateVarObj(hover_string);
                                             prog.watch_vars.push_back(add);
                                             QueryWatchlist();
@@ -2589,21 +2706,32 @@ void Draw()
                                             hover_time = ImGui::GetTime();
                                             hover_value_evaluated = false;
                                             hover_value = "";
+                                            hover_id++;
                                         }
 
 
                                         if (!hover_value_evaluated)
                                         {
-                                            if (ImGui::GetTime() - hover_time > (gui.hover_delay_ms / 1000.0))
+                                            double hover_delay = gui.hover_delay_ms / 1000.0;
+                                            if (ImGui::GetTime() - hover_time <= hover_delay)
+                                            {
+                                                RequestRedraw(hover_delay - (ImGui::GetTime() - hover_time));
+                                            }
+                                            else
                                             {
                                                 hover_value_evaluated = true;
-                                                String word(line.data() + word_idx, char_idx - word_idx);
+                                                String word(line.data + word_idx, char_idx - word_idx);
                                                 tsnprintf(tmpbuf, "-data-evaluate-expression --frame %zu --thread %d \"%s\"", 
                                                           prog.frame_idx, GetActiveThreadID(), word.c_str());
-                                                if (GDB_SendBlocking(tmpbuf, rec))
+
+                                                // ignore the result if the mouse moved on before it came back
+                                                uint32_t this_hover_id = ++hover_id;
+                                                GDB_SendAsync(tmpbuf, [this_hover_id](const Record &hover_rec, bool ok)
                                                 {
-                                                    hover_value = GDB_ExtractValue("value", rec);
-                                                }
+                                                    static constexpr AtomPath VALUE = "value";
+                                                    if (ok && this_hover_id == hover_id)
+                                                        hover_value = GDB_ExtractValue(VALUE, hover_rec);
+                                                });
                                             }
                                         }
                                         else
@@ -2619,8 +2747,8 @@ void Draw()
                                     }
 
                                     char n = '\0';
-                                    if (char_idx + 1 < line.size())
-                                        n = line[char_idx + 1];
+                                    if (char_idx + 1 < line.size)
+                                        n = line.data[char_idx + 1];
 
                                     // C/C++: skip over struct syntax chars to evaluate their members
                                     if (c == '.')
@@ -2653,8 +2781,8 @@ void Draw()
                                 if (delim_idx != BAD_INDEX)
                                 {
                                     // advance non-ident text width
-                                    ImVec2 dim = ImGui::CalcTextSize(line.data() + delim_idx, 
-                                                                     line.data() + char_idx);
+                                    ImVec2 dim = ImGui::CalcTextSize(line.data + delim_idx, 
+                                                                     line.data + char_idx);
                                     textstart.x += dim.x;
                                 }
                                 word_idx = char_idx;
@@ -2669,6 +2797,7 @@ void Draw()
                      prog.frame_idx < prog.frames.size() &&
                      prog.frames[prog.frame_idx].file_idx == prog.file_idx)
             {
+                uint64_t disasm_start_ns = GetNanoseconds();
                 const Frame &frame = prog.frames[prog.frame_idx];
                 // automatically scroll to the next executed line if it is far enough away
                 // and we've just stopped execution
@@ -2701,10 +2830,10 @@ void Draw()
                             {
                                 size_t lidx = gui.line_disasm_source[src_idx].line_idx;
                                 inst_left = gui.line_disasm_source[src_idx].num_instructions;
-                                if (lidx < file.lines.size())
+                                if (lidx < GetLineCount(file))
                                 {
-                                    String s = GetLine(file, lidx);
-                                    ImGui::Text("%s", s.c_str());
+                                    StringView s = GetLine(file, lidx);
+                                    ImGui::TextUnformatted(s.data, s.data + s.size);
                                 }
 
                                 src_idx++;
@@ -2716,13 +2845,8 @@ void Draw()
                         inst_left--;
                     }
 
-                    bool is_breakpoint_set = false;
-                    for (Breakpoint &bkpt : prog.breakpoints)
-                    {
-                        if (bkpt.addr == line.addr && 
-                            bkpt.file_idx == frame.file_idx)
-                            is_breakpoint_set = true;
-                    }
+                    auto bkpt_addr = prog.breakpoint_addrs.find(line.addr);
+                    bool is_breakpoint_set = (bkpt_addr != prog.breakpoint_addrs.end());
 
                     // start radio button style
                     ImColor window_bg_color = ImGui::GetStyleColorVec4(ImGuiCol_WindowBg);
@@ -2754,28 +2878,18 @@ void Draw()
                         // dispatch command to set breakpoint
                         if (is_breakpoint_set)
                         {
-                            for (size_t b = 0; b < prog.breakpoints.size(); b++)
-                            {
-                                Breakpoint &bkpt = prog.breakpoints[b];
-                                if (bkpt.addr == line.addr && bkpt.file_idx == frame.file_idx)
-                                {
-                                    // remove breakpoint
-                                    tsnprintf(tmpbuf, "-break-delete %zu", bkpt.number);
-                                    if (GDB_SendBlocking(tmpbuf))
-                                    {
-                                        prog.breakpoints.erase(prog.breakpoints.begin() + b,
-                                                               prog.breakpoints.begin() + b + 1);
-                                    }
-                                    break;
-                                }
-                            }
+                            // remove breakpoint
+                            size_t number = bkpt_addr->second;
+                            tsnprintf(tmpbuf, "-break-delete %zu", number);
+                            if (GDB_SendBlocking(tmpbuf))
+                                RemoveBreakpoint(number);
                         }
                         else
                         {
                             // insert breakpoint
                             tsnprintf(tmpbuf, "-break-insert *0x%" PRIx64, line.addr);
                             if (GDB_SendBlocking(tmpbuf, rec))
-                                prog.breakpoints.push_back(ExtractBreakpoint(rec));
+                                SetBreakpoint(ExtractBreakpoint(rec));
                         }
                     }
 
@@ -2809,6 +2923,7 @@ void Draw()
                         //}
                     }
                 }
+                AddDrawTime(DrawWindow_Disassembly, disasm_start_ns);
             }
 
 
@@ -2850,7 +2965,7 @@ void Draw()
                 {
                     size_t line_idx = ImGui::GetScrollY() / lineheight;
                     if ((line_idx > 0 && scroll_dir == -1) ||
-                        (line_idx + 1 < file.lines.size() && scroll_dir == 1))
+                        (line_idx + 1 < GetLineCount(file) && scroll_dir == 1))
                     {
                         // TODO: vsync frequency dependent, get consistent scroll
                         ImGui::SetScrollY((line_idx + scroll_dir) * lineheight);
@@ -2866,10 +2981,14 @@ void Draw()
         ImGui::End();
         ImGui::PopFont();
         ImGui::GetStyle().FrameBorderSize = saved_frame_border_size; // restore saved size
+        // disassembly was timed on its own, Draw only runs once a frame
+        AddDrawTime(DrawWindow_Source, window_start_ns, 
+                    gui.this_frame.draw_ns[DrawWindow_Disassembly]);
     }
 
     if (gui.show_control)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowBgAlpha(1.0);   // @Imgui: bug where GetStyleColor doesn't respect window opacity
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Control", &gui.show_control, ImGuiWindowFlags_NoScrollbar);
@@ -2946,6 +3065,69 @@ void Draw()
         HelpText("Execute until selected stack frame returns.\n"
                  "gdb equivalent is \"finish\"");
 
+        // jump through the console history by byte offset or time
+        static size_t console_jump_row = BAD_INDEX;
+        ImGui::SameLine();
+        if (ImGui::Button("Jump##Console"))
+            ImGui::OpenPopup("##ConsoleJump");
+        HelpText("Jump to a byte offset or a time in the console output");
+
+        if (ImGui::BeginPopup("##ConsoleJump"))
+        {
+            ConsoleLog &log = prog.log;
+            if (log.fd >= 0)
+                ImGui::Text("%s", log.filename.c_str());
+            ImGui::Text("%zu lines, %.1f MB", ConsoleNumLines(log), log.size / (1024.0 * 1024.0));
+
+            static char offset_buf[32];
+            if (ImGui::InputText("Byte Offset##ConsoleJump", offset_buf, sizeof(offset_buf), 
+                                 ImGuiInputTextFlags_CharsDecimal | ImGuiInputTextFlags_EnterReturnsTrue))
+            {
+                console_jump_row = ConsoleFindOffset(log, strtoull(offset_buf, NULL, 10));
+                ImGui::CloseCurrentPopup();
+            }
+
+            if (ImGui::Button("Start##ConsoleJump"))
+            {
+                console_jump_row = 0;
+                ImGui::CloseCurrentPopup();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("End##ConsoleJump"))
+            {
+                console_jump_row = (ConsoleNumLines(log) > 0) ? ConsoleNumLines(log) - 1 : 0;
+                ImGui::CloseCurrentPopup();
+            }
+
+            // a marker for every second that had output, skip the ones already dropped
+            size_t first_marker = 0;
+            while (first_marker < log.markers.size() && 
+                   log.markers[first_marker].line < ConsoleFirstLine(log))
+                first_marker++;
+
+            ImGui::BeginChild("##ConsoleMarkers", ImVec2(300, 200), true);
+            ImGuiListClipper clipper;
+            clipper.Begin((int)(log.markers.size() - first_marker));
+            while (clipper.Step())
+            {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                {
+                    const ConsoleMarker &marker = log.markers[first_marker + row];
+                    char timebuf[32];
+                    strftime(timebuf, sizeof(timebuf), "%H:%M:%S", localtime(&marker.time));
+                    tsnprintf(tmpbuf, "%s  line %zu##ConsoleMarker%d", timebuf, marker.line, row);
+                    if (ImGui::Selectable(tmpbuf))
+                    {
+                        console_jump_row = marker.line - ConsoleFirstLine(log);
+                        ImGui::CloseCurrentPopup();
+                    }
+                }
+            }
+            ImGui::EndChild();
+
+            ImGui::EndPopup();
+        }
+
         if (prog.source_out_of_date)
         {
             ImGui::SameLine();
@@ -3203,17 +3385,22 @@ void Draw()
             if (phrases.size() == 0)
             {
                 String cmd = StringPrintf("-complete \"%s\"", input_command.c_str());
-                if (GDB_SendBlocking(cmd.c_str(), rec))
+                String this_phrase = input_command;
+                GDB_SendAsync(cmd.c_str(), [this_phrase](const Record &complete_rec, bool ok)
                 {
-                    phrase_idx = 0;
-                    phrases.clear();
-                    query_phrase = input_command;
-                    const RecordAtom *matches = GDB_ExtractAtom("matches", rec);
-                    for (const RecordAtom &match : GDB_IterChild(rec, matches))
+                    if (ok)
                     {
-                        phrases.push_back( GetAtomString(match.value, rec) );
+                        phrase_idx = 0;
+                        phrases.clear();
+                        query_phrase = this_phrase;
+                        static constexpr AtomPath MATCHES = "matches";
+                        const RecordAtom *matches = GDB_ExtractAtom(MATCHES, complete_rec);
+                        for (const RecordAtom &match : GDB_IterChild(complete_rec, matches))
+                        {
+                            phrases.push_back( GetAtomString(match, complete_rec) );
+                        }
                     }
-                }
+                });
             }
             else
             {
@@ -3235,73 +3422,85 @@ void Draw()
 
 
         {
-            if (prog.started)
-            {
-                // read in inferior stdout
-                while (true)
-                {
-                    pollfd p = {};
-                    p.fd = gdb.fd_ptty_master;
-                    p.events = POLLIN;
-
-                    int rc = poll(&p, 1, 0);
-                    if (rc < 0)
-                    {
-                        PrintErrorf("poll %s\n", GetErrorString(errno));
-                        break;
-                    }
-                    else if (rc == 0) // timeout
-                    {
-                        break;
-                    }
-                    else if (rc > 0)
-                    {
-                        // ensure we got data ready to poll
-                        if ((p.revents & POLLIN) == 0)
-                            break; 
-
-                        char buf[1024] = {};
-                        int bytes_read = read(gdb.fd_ptty_master, buf, sizeof(buf));
-                        if (bytes_read < 0)
-                        {
-                            PrintErrorf("read %s\n", GetErrorString(errno));
-                            break;
-                        }
-                        else
-                        {
-                            WriteToConsoleBuffer(buf, bytes_read);
-                        }
-                    }
-                }
-
-            }
-
-            // draw the console log
+            // draw the console log, leave room on the right for the line scrollbar
+            float scrollbar_size = ImGui::GetStyle().ScrollbarSize;
             ImGui::SetCursorPos(logstart);
             ImVec2 logsize = ImGui::GetWindowSize();
             logsize.y = logsize.y - logstart.y - CONSOLE_BAR_HEIGHT;
-            logsize.x = 0.0f; // take up the full window width
+            logsize.x = -scrollbar_size;
+            ImGui::SetNextWindowContentSize(ImVec2(0.0f, 1.0f));  // no imgui vertical scrolling, width is still measured
             ImGui::BeginChild("##GDB_Console", logsize, true, ImGuiWindowFlags_HorizontalScrollbar);
 
             // draw the log lines upwards from the bottom of the child window
             // @@@ ImGui::SetCursorPosY( GetMax(ImGui::GetCursorPosY(), logsize.y - prog.num_log_rows * ImGui::GetTextLineHeightWithSpacing()) );
 
-            ImGui::TextUnformatted(prog.log, prog.log + prog.log_idx);
+            // scrolled by line index instead of imgui pixels, a float pixel
+            // offset can't land on a single line past a few million of them.
+            // only a page of lines is submitted so the child never scrolls vertically
+            static size_t console_top_line = 0;     // absolute, stays put when old lines are dropped
+            static bool console_follow = true;      // show new output unless scrolled back through the history
+            ConsoleLog &log = prog.log;
+            ImGuiIO &io = ImGui::GetIO();
+            size_t num_lines = ConsoleNumLines(log);
+            size_t page_lines = (size_t)(ImGui::GetContentRegionAvail().y / ImGui::GetTextLineHeightWithSpacing());
+            if (page_lines == 0) page_lines = 1;
+            size_t max_row = (num_lines > page_lines) ? num_lines - page_lines : 0;
+            size_t top_row = (console_top_line > ConsoleFirstLine(log)) ? console_top_line - ConsoleFirstLine(log) : 0;
+
+            if (console_jump_row != BAD_INDEX)
+            {
+                top_row = console_jump_row;
+                console_jump_row = BAD_INDEX;
+            }
+            else if (ImGui::IsWindowHovered() && io.MouseWheel != 0.0f && !io.KeyShift)
+            {
+                // same step as an imgui window, shift + wheel is left for the horizontal scroll
+                ImS64 step = (ImS64)(io.MouseWheel * 5.0f);
+                if (step == 0) step = (io.MouseWheel > 0.0f) ? 1 : -1;
+                top_row = (step > 0 && (size_t)step > top_row) ? 0 : top_row - step;
+            }
+            else if (console_follow)
+            {
+                top_row = max_row;
+            }
+            if (top_row > max_row) top_row = max_row;
 
-            if (prog.log_scroll_to_bottom) 
+            static String straddle_scratch;
+            for (size_t row = top_row; row < top_row + page_lines && row < num_lines; row++)
             {
-                ImGui::SetScrollHereY(1.0f);
-                prog.log_scroll_to_bottom = false;
+                StringView line = ConsoleGetLine(log, row, straddle_scratch);
+                ImGui::TextUnformatted(line.data, line.data + line.size);
             }
 
             ImGui::EndChild();
+
+            if (num_lines > page_lines)
+            {
+                ImVec2 child_min = ImGui::GetItemRectMin();
+                ImVec2 child_max = ImGui::GetItemRectMax();
+                ImRect bb(ImVec2(child_max.x, child_min.y), ImVec2(child_max.x + scrollbar_size, child_max.y));
+                ImS64 scroll_row = (ImS64)top_row;
+                ImGui::ScrollbarEx(bb, ImGui::GetID("##GDB_ConsoleScrollbar"), ImGuiAxis_Y, &scroll_row, 
+                                   (ImS64)page_lines, (ImS64)num_lines, ImDrawFlags_RoundCornersNone);
+                if ((size_t)scroll_row != top_row)
+                {
+                    // the lines for this frame are already drawn
+                    top_row = (size_t)scroll_row;
+                    RequestRedraw();
+                }
+            }
+
+            console_top_line = ConsoleFirstLine(log) + top_row;
+            console_follow = (top_row >= max_row);
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_Console, window_start_ns);
     }
 
     if (gui.show_locals)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowBgAlpha(1.0);   // @Imgui: bug where GetStyleColor doesn't respect window opacity
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Locals", &gui.show_locals);
@@ -3337,10 +3536,12 @@ void Draw()
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_Locals, window_start_ns);
     }
 
     if (gui.show_callstack)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Callstack", &gui.show_callstack);
 
@@ -3393,6 +3594,7 @@ void Draw()
                 if (frame.file_idx < prog.files.size())
                 {
                     prog.file_idx = frame.file_idx;
+                    UseFile(prog.source_cache, prog.files, prog.file_idx);
                     QueryFrame(true);
                 }
 
@@ -3400,6 +3602,7 @@ void Draw()
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_Callstack, window_start_ns);
     }
 
     if (gui.show_registers)
@@ -3437,6 +3640,7 @@ void Draw()
     //
     if (gui.show_watch)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Watch", &gui.show_watch);
         if (ImGui::BeginTable("##WatchTable", 2, TABLE_FLAGS))
@@ -3572,6 +3776,7 @@ void Draw()
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_Watch, window_start_ns);
     }
 
 
@@ -3580,6 +3785,7 @@ void Draw()
     //
     if (gui.show_breakpoints)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Breakpoints", &gui.show_breakpoints);
         if (ImGui::BeginTable("##BreakpointsTable", 5, TABLE_FLAGS))
@@ -3598,21 +3804,38 @@ void Draw()
 
             // enable all, disable all, delete all
             ImGui::TableSetColumnIndex(0);
-            if (ImGui::Button("X##BreakpointDeleteAll") && GDB_SendBlocking("-break-delete --all"))
-                prog.breakpoints.clear();
+            if (ImGui::Button("X##BreakpointDeleteAll"))
+            {
+                GDB_SendAsync("-break-delete --all", [](const Record &, bool ok)
+                {
+                    if (ok) ClearBreakpoints();
+                });
+            }
             HelpText("Delete all of the breakpoints and watchpoints");
 
             ImGui::SameLine();
-            if (ImGui::Checkbox("##BreakpointEnableAll", &tmp) && GDB_SendBlocking("-break-enable --all"))
-                for (Breakpoint &b : prog.breakpoints)
-                    b.enabled = true;
+            if (ImGui::Checkbox("##BreakpointEnableAll", &tmp))
+            {
+                GDB_SendAsync("-break-enable --all", [](const Record &, bool ok)
+                {
+                    if (ok)
+                        for (Breakpoint &b : prog.breakpoints)
+                            SetBreakpointEnabled(b.number, true);
+                });
+            }
             HelpText("Enable all of the breakpoints");
 
             tmp = false;
             ImGui::SameLine();
-            if (ImGui::Checkbox("##BreakpointDisableAll", &tmp) && GDB_SendBlocking("-break-disable --all"))
-                for (Breakpoint &b : prog.breakpoints)
-                    b.enabled = false;
+            if (ImGui::Checkbox("##BreakpointDisableAll", &tmp))
+            {
+                GDB_SendAsync("-break-disable --all", [](const Record &, bool ok)
+                {
+                    if (ok)
+                        for (Breakpoint &b : prog.breakpoints)
+                            SetBreakpointEnabled(b.number, false);
+                });
+            }
             HelpText("Disable all of the breakpoints");
 
             ImGui::TableSetColumnIndex(1);
@@ -3632,102 +3855,127 @@ void Draw()
             // InputText color
             ImGui::PushStyleColor(ImGuiCol_FrameBg, IM_COL32(255,255,255,16));
 
-            for (size_t i = 0; i < prog.breakpoints.size(); i++)
-            {
-                Breakpoint &iter = prog.breakpoints[i];
-                ImGui::TableNextRow();
+            // only the visible rows, keep the one being edited so its input stays active
+            ImGuiListClipper clipper;
+            clipper.Begin((int)prog.breakpoints.size());
+            if (edit_bkpt_idx < prog.breakpoints.size())
+                clipper.ForceDisplayRangeByIndices((int)edit_bkpt_idx, (int)edit_bkpt_idx + 1);
 
-                ImGui::TableSetColumnIndex(0);
-                tsnprintf(tmpbuf, "X##BreakpointDelete%d", (int)i);
-                if (ImGui::Button(tmpbuf))
+            while (clipper.Step())
+            {
+                for (size_t i = clipper.DisplayStart; i < (size_t)clipper.DisplayEnd; i++)
                 {
-                    tsnprintf(tmpbuf, "-break-delete %zu", iter.number);
-                    if (GDB_SendBlocking(tmpbuf))
+                    Breakpoint &iter = prog.breakpoints[i];
+                    ImGui::TableNextRow();
+
+                    ImGui::TableSetColumnIndex(0);
+                    tsnprintf(tmpbuf, "X##BreakpointDelete%d", (int)i);
+                    if (ImGui::Button(tmpbuf))
                     {
-                        prog.breakpoints.erase(prog.breakpoints.begin() + i,
-                                               prog.breakpoints.begin() + i + 1);
-                        continue;
+                        // breakpoints can be added/removed before the result comes back,
+                        // find them again by number
+                        size_t number = iter.number;
+                        tsnprintf(tmpbuf, "-break-delete %zu", number);
+                        GDB_SendAsync(tmpbuf, [number](const Record &, bool ok)
+                        {
+                            if (ok)
+                                RemoveBreakpoint(number);
+                        });
                     }
-                }
 
-                ImGui::SameLine();
-                tsnprintf(tmpbuf, "##BreakpointToggle%d", (int)i);
-                tmp = iter.enabled;
-                if (ImGui::Checkbox(tmpbuf, &tmp))
-                {
-                    if (iter.enabled) 
-                        tsnprintf(tmpbuf, "-break-disable %zu", iter.number);
-                    else
-                        tsnprintf(tmpbuf, "-break-enable %zu", iter.number);
+                    ImGui::SameLine();
+                    tsnprintf(tmpbuf, "##BreakpointToggle%d", (int)i);
+                    tmp = iter.enabled;
+                    if (ImGui::Checkbox(tmpbuf, &tmp))
+                    {
+                        if (iter.enabled) 
+                            tsnprintf(tmpbuf, "-break-disable %zu", iter.number);
+                        else
+                            tsnprintf(tmpbuf, "-break-enable %zu", iter.number);
 
-                    if (GDB_SendBlocking(tmpbuf))
-                        iter.enabled = !iter.enabled;
-                }
+                        size_t number = iter.number;
+                        bool enabled = !iter.enabled;
+                        GDB_SendAsync(tmpbuf, [number, enabled](const Record &, bool ok)
+                        {
+                            if (ok)
+                                SetBreakpointEnabled(number, enabled);
+                        });
+                    }
 
-                // check if breakpoint doesn't have line (watchpoints)
-                bool has_line = IsValidLine(iter.line_idx, iter.file_idx);
+                    // check if breakpoint doesn't have line (watchpoints), from the record
+                    // since the file may not be loaded
+                    bool has_line = (iter.line_idx != BAD_INDEX && iter.file_idx < prog.files.size());
 
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%d", (int)iter.number);
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%d", (int)iter.number);
 
-                ImGui::TableSetColumnIndex(2);
-                static char editcond[1024];
-                if (i == edit_bkpt_idx)
-                {
-                    if (ImGui::InputText("##EditBreakpointCond", 
-                                         editcond, sizeof(editcond), 
-                                         ImGuiInputTextFlags_EnterReturnsTrue,
-                                         NULL, NULL))
+                    ImGui::TableSetColumnIndex(2);
+                    static char editcond[1024];
+                    if (i == edit_bkpt_idx)
                     {
-                        gdb.echo_next_no_symbol_in_context = true;
-                        tsnprintf(tmpbuf, "-break-condition %d %s", (int)iter.number, editcond);
-                        if (GDB_SendBlocking(tmpbuf, rec))
+                        if (ImGui::InputText("##EditBreakpointCond", 
+                                             editcond, sizeof(editcond), 
+                                             ImGuiInputTextFlags_EnterReturnsTrue,
+                                             NULL, NULL))
                         {
-                            iter.cond = editcond;
+                            gdb.echo_next_no_symbol_in_context = true;
+                            tsnprintf(tmpbuf, "-break-condition %d %s", (int)iter.number, editcond);
+
+                            size_t number = iter.number;
+                            String cond = editcond;
+                            GDB_SendAsync(tmpbuf, [number, cond](const Record &, bool ok)
+                            {
+                                Breakpoint *b = FindBreakpoint(number);
+                                if (ok && b != NULL)
+                                {
+                                    b->cond = cond;
+                                }
+                                else
+                                {
+                                    // bad condition, clear it out
+                                    String clear_cmd = StringPrintf("-break-condition %d", (int)number);
+                                    GDB_SendAsync(clear_cmd.c_str(), [](const Record &, bool) {});
+                                }
+                            });
+
+                            Zeroize(editcond);
+                            edit_bkpt_idx = BAD_INDEX;
                         }
-                        else
+
+                        if (focus_cond_input)
                         {
-                            tsnprintf(tmpbuf, "-break-condition %d", (int)iter.number);
-                            GDB_SendBlocking(tmpbuf, rec);
+                            ImGui::SetKeyboardFocusHere(-1);
+                            focus_cond_input = false;
                         }
 
-                        Zeroize(editcond);
-                        edit_bkpt_idx = BAD_INDEX;
+                        // user clicked outside of textbox
+                        if (ImGui::IsItemDeactivated())
+                            edit_bkpt_idx = BAD_INDEX;
                     }
-
-                    if (focus_cond_input)
+                    else
                     {
-                        ImGui::SetKeyboardFocusHere(-1);
-                        focus_cond_input = false;
+                        // check if table cell is clicked
+                        ImVec2 p0 = ImGui::GetCursorScreenPos();
+                        ImGuiDisabled(!has_line, ImGui::Text("%s", iter.cond.c_str()));
+                        ImVec2 sz = ImVec2(ImGui::GetColumnWidth(), ImGui::GetCursorScreenPos().y - p0.y);
+
+                        if (has_line &&
+                            ImGui::IsMouseHoveringRect(p0, p0 + sz) && 
+                            ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+                        {
+                            tsnprintf(editcond, "%s", iter.cond.c_str());
+                            edit_bkpt_idx = i;
+                            focus_cond_input = true;
+                        }
                     }
 
-                    // user clicked outside of textbox
-                    if (ImGui::IsItemDeactivated())
-                        edit_bkpt_idx = BAD_INDEX;
-                }
-                else
-                {
-                    // check if table cell is clicked
-                    ImVec2 p0 = ImGui::GetCursorScreenPos();
-                    ImGuiDisabled(!has_line, ImGui::Text("%s", iter.cond.c_str()));
-                    ImVec2 sz = ImVec2(ImGui::GetColumnWidth(), ImGui::GetCursorScreenPos().y - p0.y);
+                    ImGui::TableSetColumnIndex(3);
+                    if (has_line)
+                        ImGui::Text("%u", (int)(iter.line_idx + 1));
 
-                    if (has_line &&
-                        ImGui::IsMouseHoveringRect(p0, p0 + sz) && 
-                        ImGui::IsMouseClicked(ImGuiMouseButton_Left))
-                    {
-                        tsnprintf(editcond, "%s", iter.cond.c_str());
-                        edit_bkpt_idx = i;
-                        focus_cond_input = true;
-                    }
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::Text("%s", (iter.file_idx < prog.files.size()) ? prog.files[iter.file_idx].filename.c_str() : "???");
                 }
-
-                ImGui::TableSetColumnIndex(3);
-                if (has_line)
-                    ImGui::Text("%u", (int)(iter.line_idx + 1));
-
-                ImGui::TableSetColumnIndex(4);
-                ImGui::Text("%s", (iter.file_idx < prog.files.size()) ? prog.files[iter.file_idx].filename.c_str() : "???");
             }
 
             ImGui::PopStyleColor();
@@ -3735,6 +3983,7 @@ void Draw()
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_Breakpoints, window_start_ns);
     }
 
     //
@@ -3742,6 +3991,7 @@ void Draw()
     //
     if (gui.show_threads)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Threads", &gui.show_threads);
         if (ImGui::BeginTable("##ThreadsTable", 4, TABLE_FLAGS))
@@ -3810,31 +4060,169 @@ void Draw()
                     GDB_SendBlocking(tmpbuf);
                 }
 
-                bool clicked_pause = false;
-                ImGui::TableSetColumnIndex(2);
-                tsnprintf(tmpbuf, "||##Thread%i", (int)i);
-                ImGuiDisabled(!thread.running, clicked_pause = ImGui::Button(tmpbuf));
-                if (clicked_pause)
-                {
-                    tsnprintf(tmpbuf, "-exec-interrupt --thread %d", thread.id); 
-                    GDB_SendBlocking(tmpbuf);
+                bool clicked_pause = false;
+                ImGui::TableSetColumnIndex(2);
+                tsnprintf(tmpbuf, "||##Thread%i", (int)i);
+                ImGuiDisabled(!thread.running, clicked_pause = ImGui::Button(tmpbuf));
+                if (clicked_pause)
+                {
+                    tsnprintf(tmpbuf, "-exec-interrupt --thread %d", thread.id); 
+                    GDB_SendBlocking(tmpbuf);
+                }
+
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("Thread ID %d Group ID %s", 
+                            thread.id, thread.group_id.c_str());
+            }
+
+            // @ImGui:: when double clicking a column separator to resize to fit, 
+            // the resize messes up with a button column header. Draw two invisible buttons
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+        AddDrawTime(DrawWindow_Threads, window_start_ns);
+    }
+
+    //
+    // MI traffic
+    //
+    if (gui.show_mi_traffic)
+    {
+        uint64_t window_start_ns = GetNanoseconds();
+        ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
+        ImGui::Begin("MI Traffic", &gui.show_mi_traffic);
+
+        size_t num_sent = 0, num_replies = 0, num_errors = 0, num_timeouts = 0;
+        for (const CommandStats &stats : gdb.command_stats)
+        {
+            num_sent += stats.count;
+            num_replies += stats.num_replies;
+            num_errors += stats.num_errors;
+            num_timeouts += stats.num_timeouts;
+        }
+
+        ImGui::Text("%zu sent, %zu replies, %zu errors, %zu timeouts", 
+                    num_sent, num_replies, num_errors, num_timeouts);
+        ImGui::SameLine();
+        if (ImGui::Button("Clear##MITraffic"))
+        {
+            gdb.sent_cmds.clear();
+            gdb.command_stats.clear();
+            gdb.traffic_start_ns = 0;
+            gdb.num_dropped_records = 0;
+            gdb.dropped_bytes = 0;
+        }
+
+        // records over the limit never reach the parser, their command gets an ^error
+        size_t num_dropped = gdb.num_dropped_records.load();
+        if (num_dropped > 0)
+        {
+            ImGui::TextColored(IM_COL32_WIN_RED, 
+                               "%zu records dropped (%.1f MB) for going over the MaxRecordSize limit of %zu MB", 
+                               num_dropped, gdb.dropped_bytes.load() / (1024.0 * 1024.0),
+                               gdb.max_record_size / (1024 * 1024));
+        }
+
+        // most total time waiting on GDB first
+        static Vector<size_t> order;
+        order.resize(gdb.command_stats.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [](size_t a, size_t b)
+        {
+            return gdb.command_stats[a].total_latency_ns > gdb.command_stats[b].total_latency_ns;
+        });
+
+        const float STATS_HEIGHT = ImGui::GetContentRegionAvail().y * 0.4f;
+        if (ImGui::BeginTable("##CommandStatsTable", 7, TABLE_FLAGS, ImVec2(0, STATS_HEIGHT)))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Command");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Errors");
+            ImGui::TableSetupColumn("Timeouts");
+            ImGui::TableSetupColumn("Bytes");
+            ImGui::TableSetupColumn("Mean ms");
+            ImGui::TableSetupColumn("Max ms");
+            ImGui::TableHeadersRow();
+
+            for (size_t i : order)
+            {
+                const CommandStats &stats = gdb.command_stats[i];
+                ImColor color = (stats.num_errors != 0 || stats.num_timeouts != 0)
+                    ? IM_COL32_WIN_RED
+                    : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+                double mean_ms = (stats.num_replies != 0) 
+                    ? stats.total_latency_ns / 1e6 / stats.num_replies : 0.0;
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", stats.verb.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%zu", stats.count);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%zu", stats.num_errors);
+                ImGui::TableNextColumn(); ImGui::TextColored(color, "%zu", stats.num_timeouts);
+                ImGui::TableNextColumn(); ImGui::Text("%" PRIu64, stats.total_bytes);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", mean_ms);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.max_latency_ns / 1e6);
+            }
+
+            ImGui::EndTable();
+        }
+
+        if (ImGui::BeginTable("##SentCommandsTable", 6, TABLE_FLAGS))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Token");
+            ImGui::TableSetupColumn("Sent s");
+            ImGui::TableSetupColumn("Reply ms");
+            ImGui::TableSetupColumn("Bytes");
+            ImGui::TableSetupColumn("Atoms");
+            ImGui::TableSetupColumn("Command");
+            ImGui::TableHeadersRow();
+
+            // only the visible rows of a long session
+            ImGuiListClipper clipper;
+            clipper.Begin((int)gdb.sent_cmds.size());
+            while (clipper.Step())
+            {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                {
+                    const SentCommand &sent = gdb.sent_cmds[row];
+                    ImColor color = (sent.error || sent.timed_out)
+                        ? IM_COL32_WIN_RED
+                        : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%u", sent.id);
+                    ImGui::TableNextColumn(); 
+                    ImGui::Text("%.3f", (sent.send_ns - gdb.traffic_start_ns) / 1e9);
+
+                    ImGui::TableNextColumn();
+                    if (sent.reply_ns != 0)
+                        ImGui::TextColored(color, "%.3f", (sent.reply_ns - sent.send_ns) / 1e6);
+                    else
+                        ImGui::TextColored(color, "%s", (sent.timed_out) ? "timeout" : "...");
+
+                    ImGui::TableNextColumn(); ImGui::Text("%zu", sent.reply_bytes);
+                    ImGui::TableNextColumn(); ImGui::Text("%zu", sent.reply_atoms);
+                    ImGui::TableNextColumn(); ImGui::TextColored(color, "%s", sent.text.c_str());
                 }
-
-                ImGui::TableSetColumnIndex(3);
-                ImGui::Text("Thread ID %d Group ID %s", 
-                            thread.id, thread.group_id.c_str());
             }
 
-            // @ImGui:: when double clicking a column separator to resize to fit, 
-            // the resize messes up with a button column header. Draw two invisible buttons
+            // follow new commands while scrolled to the bottom
+            if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+                ImGui::SetScrollHereY(1.0f);
+
             ImGui::EndTable();
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_MITraffic, window_start_ns);
     }
 
     if (gui.show_directory_viewer)
     {
+        uint64_t window_start_ns = GetNanoseconds();
         // treenode directory viewer
         ImGui::SetNextWindowSize(MIN_WINSIZE, ImGuiCond_Once);
         ImGui::Begin("Directory Viewer", &gui.show_directory_viewer);
@@ -3893,8 +4281,7 @@ void Draw()
                         else
                         {
                             size_t idx = FindOrCreateFile(abspath);
-                            File &f = prog.files[idx];
-                            if (f.lines.size() > 0 || LoadFile(f))
+                            if (UseFile(prog.source_cache, prog.files, idx))
                             {
                                 prog.file_idx = idx;
                                 gui.jump_type = Jump_Goto;
@@ -3984,6 +4371,7 @@ void Draw()
         }
 
         ImGui::End();
+        AddDrawTime(DrawWindow_DirectoryViewer, window_start_ns);
     }
 
     if (gui.show_tutorial)
@@ -4115,15 +4503,353 @@ static void glfw_error_callback(int error, const char* description)
     PrintErrorf("Glfw Error %d %s\n", error, description);
 }
 
+static void PrintStopBench()
+{
+    static const char *PHASE_NAMES[StopPhase_Count] = 
+    {
+        "gdb", "stack", "locals", "var-update", "watches", "disassembly", "frame",
+    };
+
+    // power of 2 millisecond buckets, last one is everything above
+    static const int BUCKET_MS[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 };
+
+    printf("%zu stops of %s\n", stop_bench.num_measured, gdb.debug_filename.c_str());
+    printf("%-12s %7s %9s %9s %9s %9s\n", 
+           "phase", "count", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (size_t p = 0; p < StopPhase_Count; p++)
+    {
+        Vector<uint64_t> &lat = stop_bench.latency_ns[p];
+        if (lat.size() == 0)
+        {
+            printf("%-12s %7d\n", PHASE_NAMES[p], 0);
+            continue;
+        }
+
+        std::sort(lat.begin(), lat.end());
+        printf("%-12s %7zu %9.2f %9.2f %9.2f %9.2f\n", PHASE_NAMES[p], lat.size(),
+               lat[ lat.size() / 2 ] / 1e6, 
+               lat[ (lat.size() * 90) / 100 ] / 1e6,
+               lat[ (lat.size() * 99) / 100 ] / 1e6,
+               lat.back() / 1e6);
+    }
+
+    printf("\n%-12s", "histogram");
+    for (int ms : BUCKET_MS)
+        printf(" %6s", StringPrintf("<%d", ms).c_str());
+    printf(" %6s\n", StringPrintf(">=%d", BUCKET_MS[ArrayCount(BUCKET_MS) - 1]).c_str());
+
+    for (size_t p = 0; p < StopPhase_Count; p++)
+    {
+        size_t counts[ArrayCount(BUCKET_MS) + 1] = {};
+        for (uint64_t ns : stop_bench.latency_ns[p])
+        {
+            size_t b = 0;
+            while (b < ArrayCount(BUCKET_MS) && ns >= (uint64_t)BUCKET_MS[b] * 1000000)
+                b++;
+            counts[b]++;
+        }
+
+        printf("%-12s", PHASE_NAMES[p]);
+        for (size_t count : counts)
+            printf(" %6zu", count);
+        printf("\n");
+    }
+}
+
+static void UpdateStopBench()
+{
+    // called after a frame is drawn, the stop is done when every 
+    // result that QueryFrame asked for has been drawn once
+    static const char *STOP_BENCH_STEPS[] = 
+    {
+        "-exec-continue", "-exec-next", "-exec-next", "-exec-step", 
+        "-exec-next", "-exec-next", "-exec-next",
+    };
+    const uint64_t STOP_TIMEOUT_NS = 60ull * 1000000000;
+
+    StopBench &bench = stop_bench;
+    uint64_t now = GetNanoseconds();
+    if (bench.stopped_ns == 0)
+    {
+        if (now - bench.sent_ns > STOP_TIMEOUT_NS)
+        {
+            printf("no stop after %s, ending benchmark\n", 
+                   STOP_BENCH_STEPS[ (bench.step_idx - 1) % ArrayCount(STOP_BENCH_STEPS) ]);
+            PrintStopBench();
+            bench.num_stops = 0;
+            glfwSetWindowShouldClose(gui.window, 1);
+        }
+        return;
+    }
+
+    if (gdb.async_cmds.size() != 0)
+        return;
+
+    if (bench.phase_ns[StopPhase_Frame] == 0)
+    {
+        bench.phase_ns[StopPhase_Frame] = now - bench.stopped_ns;
+        for (size_t p = 0; p < StopPhase_Count; p++)
+            if (bench.phase_ns[p] != 0)
+                bench.latency_ns[p].push_back(bench.phase_ns[p]);
+
+        bench.num_measured++;
+        if (bench.num_measured >= bench.num_stops)
+        {
+            PrintStopBench();
+            bench.num_stops = 0;
+            glfwSetWindowShouldClose(gui.window, 1);
+            return;
+        }
+    }
+
+    // restart the program once it runs off the end, a failed step 
+    // gets retried with the next command on the next frame
+    bool sent = false;
+    bench.sent_ns = GetNanoseconds();
+    if (!prog.started)
+    {
+        sent = GDB_SendBlocking("-exec-run");
+    }
+    else
+    {
+        const char *cmd = STOP_BENCH_STEPS[ bench.step_idx % ArrayCount(STOP_BENCH_STEPS) ];
+        bench.step_idx++;
+        sent = ExecuteCommand(cmd);
+    }
+
+    if (sent)
+        bench.stopped_ns = 0;
+}
+
+static void SetupFrameBench()
+{
+    // scripted debug state for --bench-frames without a transcript,
+    // every count grows with --bench-scale
+    const size_t scale = frame_bench.scale;
+    const size_t num_lines = 20000 * scale;
+
+    size_t file_idx = FindOrCreateFile("bench_source.c");
+    File &file = prog.files[file_idx];
+    String text;
+    for (size_t i = 0; i < num_lines; i++)
+    {
+        text += (i % 16 == 0)
+            ? StringPrintf("int bench_func_%zu(int arg, const char *name)\n", i / 16)
+            : StringPrintf("    total += values[%zu] * arg; // running sum %zu\n", i % 97, i);
+    }
+    SetFileText(file, text);
+    prog.file_idx = file_idx;
+
+    for (size_t i = 0; i < 64 * scale; i++)
+    {
+        Frame frame = {};
+        frame.line_idx = (num_lines / 2 + i * 16) % num_lines;
+        frame.func = StringPrintf("bench_func_%zu", frame.line_idx / 16);
+        frame.addr = 0x401000 + i * 0x40;
+        frame.file_idx = file_idx;
+        prog.frames.push_back(frame);
+    }
+    prog.frame_idx = 0;
+    prog.started = true;
+    gui.line_display = LineDisplay_Source_And_Disassembly;
+
+    // rbreak sized, one in 8 disabled
+    for (size_t i = 0; i < 1024 * scale; i++)
+    {
+        Breakpoint bkpt = {};
+        bkpt.number = i + 1;
+        bkpt.file_idx = file_idx;
+        bkpt.line_idx = (i * 13) % num_lines;
+        bkpt.addr = 0x401000 + bkpt.line_idx * 0x10;
+        bkpt.enabled = (i % 8 != 0);
+        SetBreakpoint(bkpt);
+    }
+    gui.show_breakpoints = true;
+    gui.jump_type = Jump_Goto;
+    gui.goto_line_idx = prog.frames[0].line_idx;
+
+    for (size_t i = 0; i < 32 * scale; i++)
+    {
+        Thread thread = {};
+        thread.id = (int)i + 1;
+        thread.group_id = "i1";
+        thread.focused = true;
+        prog.threads.push_back(thread);
+    }
+    prog.thread_idx = 0;
+    gui.show_threads = true;
+
+    for (size_t i = 0; i < 64 * scale; i++)
+    {
+        String name = StringPrintf("local_%zu", i);
+        String value = (i % 4 != 0) ? StringPrintf("%zu", i * 7) :
+            StringPrintf("{id = %zu, name = 0x555555556004 \"item %zu\", pos = {x = 1.5, y = -2, z = 0}, "
+                         "data = {1, 2, 3, 4, 5, 6, 7, 8}, next = 0x0}", i, i);
+        prog.local_vars.push_back( CreateVarObj(name, value) );
+    }
+
+    for (size_t i = 0; i < 16 * scale; i++)
+    {
+        String name = StringPrintf("values[%zu]", i);
+        prog.watch_vars.push_back( CreateVarObj(name, StringPrintf("%zu", i * 3)) );
+    }
+
+    // a stop's worth of round trips over and over, one in 64 errors
+    static const char *VERBS[] = 
+    {
+        "-stack-list-frames", "-stack-list-variables", "-var-update", 
+        "-data-evaluate-expression", "-data-list-register-values",
+    };
+    for (size_t i = 0; i < ArrayCount(VERBS); i++)
+    {
+        CommandStats stats = {};
+        stats.verb = VERBS[i];
+        gdb.command_stats.push_back(stats);
+    }
+
+    gdb.traffic_start_ns = GetNanoseconds();
+    for (size_t i = 0; i < 4096 * scale; i++)
+    {
+        SentCommand sent = {};
+        sent.id = (uint32_t)i + 1;
+        sent.stats_idx = i % ArrayCount(VERBS);
+        sent.text = StringPrintf("%s --thread 1 --frame 0 bench_%zu", VERBS[sent.stats_idx], i);
+        sent.send_ns = gdb.traffic_start_ns + i * 100000;
+        sent.reply_ns = sent.send_ns + 20000 + (i % 13) * 5000;
+        sent.reply_bytes = 64 + (i % 31) * 16;
+        sent.reply_atoms = 4 + (i % 31);
+        sent.error = (i % 64 == 63);
+        gdb.sent_cmds.push_back(sent);
+
+        CommandStats &stats = gdb.command_stats[sent.stats_idx];
+        stats.count++;
+        stats.num_replies++;
+        stats.num_errors += (sent.error) ? 1 : 0;
+        stats.total_bytes += sent.reply_bytes;
+        stats.total_latency_ns += sent.reply_ns - sent.send_ns;
+        stats.max_latency_ns = GetMax(stats.max_latency_ns, sent.reply_ns - sent.send_ns);
+    }
+    gui.show_mi_traffic = true;
+
+    for (size_t i = 0; i < 2000 * scale; i++)
+    {
+        String msg = StringPrintf("bench console line %zu\n", i);
+        WriteToConsoleBuffer(msg.data(), msg.size());
+    }
+
+    // 4 instructions for every source line around the first frame
+    const Frame &frame = prog.frames[0];
+    size_t num_around = 512 * scale;
+    size_t first_line = (frame.line_idx > num_around) ? frame.line_idx - num_around : 0;
+    size_t last_line = GetMin(num_lines, frame.line_idx + num_around);
+    uint64_t addr = frame.addr;
+    for (size_t line_idx = first_line; line_idx < last_line; line_idx++)
+    {
+        DisassemblySourceLine line_src = {};
+        line_src.addr = addr;
+        line_src.line_idx = line_idx;
+        line_src.num_instructions = 4;
+        gui.line_disasm_source.push_back(line_src);
+
+        for (size_t i = 0; i < line_src.num_instructions; i++, addr += 4)
+        {
+            DisassemblyLine line = {};
+            line.addr = addr;
+            line.text = StringPrintf("0x%016llx <bench_func+%llu> mov    0x%zu(%%rbp),%%eax",
+                                     (unsigned long long)addr, 
+                                     (unsigned long long)(addr - frame.addr), i * 4);
+            gui.line_disasm.push_back(line);
+        }
+    }
+}
+
+static void PrintFrameBench()
+{
+    printf("%zu frames, %zu source lines, %zu locals, %zu stack frames, %zu threads, %zu breakpoints\n", 
+           frame_bench.frame_ns.size(), 
+           (prog.file_idx < prog.files.size()) ? GetLineCount(prog.files[prog.file_idx]) : 0,
+           prog.local_vars.size(), prog.frames.size(), prog.threads.size(), prog.breakpoints.size());
+    printf("%-18s %7s %9s %9s %9s %9s\n", 
+           "window", "count", "mean us", "p50 us", "p99 us", "max us");
+
+    const auto PrintRow = [](const char *name, Vector<uint64_t> &ns)
+    {
+        if (ns.size() == 0)
+        {
+            printf("%-18s %7d\n", name, 0);
+            return;
+        }
+
+        uint64_t sum = 0;
+        for (uint64_t x : ns)
+            sum += x;
+
+        std::sort(ns.begin(), ns.end());
+        printf("%-18s %7zu %9.1f %9.1f %9.1f %9.1f\n", name, ns.size(),
+               (sum / 1e3) / ns.size(),
+               ns[ ns.size() / 2 ] / 1e3,
+               ns[ (ns.size() * 99) / 100 ] / 1e3,
+               ns.back() / 1e3);
+    };
+
+    for (size_t w = 0; w < DrawWindow_Count; w++)
+        PrintRow(DRAW_WINDOW_NAMES[w], frame_bench.draw_ns[w]);
+    PrintRow("frame", frame_bench.frame_ns);
+}
+
+static void UpdateFrameBench(uint64_t frame_ns)
+{
+    // called after a frame is drawn, the first frames load the fonts
+    // and the dock layout so they get left out
+    const size_t WARMUP_FRAMES = 8;
+
+    FrameBench &bench = frame_bench;
+    bench.num_drawn++;
+    if (bench.num_drawn > WARMUP_FRAMES)
+    {
+        // source is only measured on its own when the disassembly isn't shown
+        for (size_t w = 0; w < DrawWindow_Count; w++)
+        {
+            if (w == DrawWindow_Source && gui.line_display != LineDisplay_Source)
+                continue;
+            if (gui.this_frame.draw_ns[w] != 0)
+                bench.draw_ns[w].push_back(gui.this_frame.draw_ns[w]);
+        }
+        bench.frame_ns.push_back(frame_ns);
+    }
+
+    // source and disassembly for the first half, source for the second,
+    // disassembly starts at the top and source scrolls to the stopped line
+    size_t num_measured = bench.frame_ns.size();
+    if (num_measured >= bench.num_frames)
+    {
+        PrintFrameBench();
+        glfwSetWindowShouldClose(gui.window, 1);
+    }
+    else if (gdb.spawned_pid == 0)
+    {
+        gui.line_display = (num_measured < bench.num_frames / 2) 
+            ? LineDisplay_Source_And_Disassembly : LineDisplay_Source;
+    }
+}
+
 void DrawDebugOverlay()
 {
     const ImGuiIO &io = ImGui::GetIO();
     static bool debug_window_toggled;
     if (IsKeyPressed(ImGuiKey_F1))
+    {
         debug_window_toggled = !debug_window_toggled;
 
+        // stats only get collected while someone is looking at them
+        TraceSetEnabled(debug_window_toggled || trace_filename != "");
+    }
+
     if (debug_window_toggled)
     {
+        // stats change without any input
+        RequestRedraw(0.25);
+
         char tmp[4096];
         ImDrawList *drawlist = ImGui::GetForegroundDrawList();
         snprintf(tmp, sizeof(tmp), "Mouse Position: (%.1f,%.1f)", io.MousePos.x, io.MousePos.y);
@@ -4144,6 +4870,42 @@ void DrawDebugOverlay()
         drawlist->AddRectFilled(TL, BR, 0xFFFFFFFF);
         drawlist->AddText(TL, 0xFF000000, tmp);
 
+        // rolling percentiles over the last TRACE_RECENT_COUNT samples of each stat
+        static Vector<TraceStat> stats;
+        static Vector<uint64_t> sorted;
+        TraceGetStats(stats);
+
+        String table = StringPrintf("%-36s %9s %9s %9s %11s\n",
+                                    "trace", "count", "p50 us", "p99 us", "bytes");
+        for (const TraceStat &stat : stats)
+        {
+            size_t num_recent = GetMin(stat.count, (uint64_t)TRACE_RECENT_COUNT);
+            if (num_recent == 0)
+                continue;
+
+            sorted.assign(stat.recent_ns, stat.recent_ns + num_recent);
+            std::sort(sorted.begin(), sorted.end());
+            uint64_t p50 = sorted[ (num_recent - 1) / 2 ];
+            uint64_t p99 = sorted[ (num_recent - 1) * 99 / 100 ];
+
+            table += StringPrintf("%-36.36s %9" PRIu64 " %9.1f %9.1f %11" PRIu64 "\n",
+                                  stat.name, stat.count, p50 / 1000.0, p99 / 1000.0, stat.bytes);
+        }
+
+        const SourceCache &cache = prog.source_cache;
+        table += StringPrintf("\nsource cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, "
+                              "%zu files %.1f / %zu MB resident\n",
+                              cache.hits, cache.misses, cache.evictions, cache.num_resident,
+                              cache.resident_bytes / (1024.0 * 1024.0), cache.max_bytes / (1024 * 1024));
+
+        TL.y = BR.y;
+        TL.x = 0;
+        BR = ImGui::CalcTextSize(table.c_str());
+        BR.x += TL.x;
+        BR.y += TL.y;
+        drawlist->AddRectFilled(TL, BR, 0xFFFFFFFF);
+        drawlist->AddText(TL, 0xFF000000, table.c_str());
+
         static bool pinned_point_toggled;
         static ImVec2 pinned_point;
         static ImVec2 pinned_window;
@@ -4273,8 +5035,36 @@ int main(int argc, char **argv)
 
     static const auto Shutdown = []()
     {
+        // stop the threads that wake the UI before GLFW goes away
+        can_wake_ui.store(false);
+        if (gdb.thread_read_interp)
+        {
+            pthread_cancel(gdb.thread_read_interp);
+            pthread_join(gdb.thread_read_interp, NULL);
+            gdb.thread_read_interp = 0;
+        }
+
+        if (gdb.thread_read_inferior)
+        {
+            pthread_cancel(gdb.thread_read_inferior);
+            pthread_join(gdb.thread_read_inferior, NULL);
+            gdb.thread_read_inferior = 0;
+        }
+
+        // everything the inferior wrote is in the spill file
+        ConsoleClose(prog.log);
+
+        // reader threads are done recording events
+        if (trace_filename != "")
+        {
+            TraceWriteChromeJson(trace_filename.c_str());
+            trace_filename = "";
+        }
+
         // shutdown imgui
+#if !defined(TUG_HEADLESS)
         if (gui.started_imgui_opengl2)  { ImGui_ImplOpenGL2_Shutdown(); gui.started_imgui_opengl2 = false; }
+#endif
         if (gui.started_imgui_glfw)     { ImGui_ImplGlfw_Shutdown(); gui.started_imgui_glfw = false; }
         if (gui.created_imgui_context)  { ImGui::DestroyContext(); gui.created_imgui_context = false; }
 
@@ -4283,26 +5073,24 @@ int main(int argc, char **argv)
         if (gui.initialized_glfw)       { glfwTerminate(); gui.initialized_glfw = false; }
 
         // shutdown GDB
-        if (gdb.thread_read_interp)
-        {
-            pthread_cancel(gdb.thread_read_interp);
-            pthread_join(gdb.thread_read_interp, NULL);
-            gdb.thread_read_interp = 0;
-        }
-
-        if (gdb.recv_block)     { sem_close(gdb.recv_block); gdb.recv_block = 0; }
         if (gdb.fd_ptty_master) { close(gdb.fd_ptty_master); gdb.fd_ptty_master = 0; }
+        if (gdb.fd_ptty_slave)  { close(gdb.fd_ptty_slave); gdb.fd_ptty_slave = 0; }
         if (gdb.fd_in_read)     { close(gdb.fd_in_read); gdb.fd_in_read = 0; }
         if (gdb.fd_out_read)    { close(gdb.fd_out_read); gdb.fd_out_read = 0; }
         if (gdb.fd_in_write)    { close(gdb.fd_in_write); gdb.fd_in_write = 0; }
         if (gdb.fd_out_write)   { close(gdb.fd_out_write); gdb.fd_out_write = 0; }
         if (gdb.spawned_pid)    { EndProcess(gdb.spawned_pid); gdb.spawned_pid = 0; }
+        if (gdb.transcript)     { fclose(gdb.transcript); gdb.transcript = NULL; }
 
-        pthread_mutex_t zmutex = {};
-        if (0 != memcmp(&zmutex, &gdb.modify_block, sizeof(pthread_mutex_t)))
+        RingFree(gdb.from_gdb);
+        RingFree(gdb.free_lines);
+
+        if (gdb.initialized_pending)
         {
-            pthread_mutex_destroy(&gdb.modify_block);
-            gdb.modify_block = zmutex;
+            for (PendingCommand &iter : gdb.pending)
+                pthread_cond_destroy(&iter.cond);
+            pthread_mutex_destroy(&gdb.pending_lock);
+            gdb.initialized_pending = false;
         }
     };
 
@@ -4326,30 +5114,20 @@ int main(int argc, char **argv)
         gdb.fd_out_read = pipes[0];
         gdb.fd_out_write = pipes[1];
 
-        rc = pthread_mutex_init(&gdb.modify_block, NULL);
-        if (rc < 0) 
-            ExitMessagef("pthread_mutex_init %s\n", GetErrorString(errno));
+        if (!RingInit(gdb.from_gdb, 4096) || !RingInit(gdb.free_lines, 4096))
+            ExitMessagef("RingInit %s\n", GetErrorString(errno));
 
-        gdb.recv_block = sem_open("/sem_recv_gdb_block", O_CREAT, S_IRWXU, 0);
-        if (gdb.recv_block == NULL) 
+        rc = pthread_mutex_init(&gdb.pending_lock, NULL);
+        if (rc != 0) 
+            ExitMessagef("pthread_mutex_init %s\n", GetErrorString(rc));
+
+        for (PendingCommand &iter : gdb.pending)
         {
-            if (errno == ENOSYS) // function not implemented
-            {
-                static sem_t unnamed_sem;
-                if (0 == sem_init(&unnamed_sem, 0, 0))
-                {
-                    gdb.recv_block = &unnamed_sem;
-                }
-                else
-                {
-                    ExitMessagef("sem_init %s\n", GetErrorString(errno));
-                }
-            }
-            else
-            {
-                ExitMessagef("sem_open %s\n", GetErrorString(errno));
-            }
+            rc = pthread_cond_init(&iter.cond, NULL);
+            if (rc != 0) 
+                ExitMessagef("pthread_cond_init %s\n", GetErrorString(rc));
         }
+        gdb.initialized_pending = true;
 
         extern void *GDB_ReadInterpreterBlocks(void *);
         rc = pthread_create(&gdb.thread_read_interp, NULL, GDB_ReadInterpreterBlocks, (void*) NULL);
@@ -4367,6 +5145,21 @@ int main(int argc, char **argv)
                 {
                     gdb.fd_ptty_master = ptty_fd;
                     Printf("pty slave: %s\n", ptsname(gdb.fd_ptty_master));
+
+                    // without a slave open the master polls as hung up, keep one 
+                    // open so the output thread can block until the inferior writes
+                    int slave_fd = open(ptsname(gdb.fd_ptty_master), O_RDWR | O_NOCTTY);
+                    if (slave_fd != -1)
+                    {
+                        gdb.fd_ptty_slave = slave_fd;
+                        rc = pthread_create(&gdb.thread_read_inferior, NULL, ReadInferiorOutput, NULL);
+                        if (rc != 0) 
+                            ExitMessagef("pthread_create %s\n", GetErrorString(rc));
+                    }
+                    else
+                    {
+                        PrintErrorf("open pty slave %s\n", GetErrorString(errno));
+                    }
                 }
                 else
                 {
@@ -4419,6 +5212,10 @@ int main(int argc, char **argv)
 #endif
     }
 
+#if defined(TUG_HEADLESS)
+    gui.headless = true;
+#endif
+
     // read in the command line args, skip exename argv[0]
     for (int i = 1; i < argc;)
     {
@@ -4429,6 +5226,12 @@ int main(int argc, char **argv)
                 "tug [flags]\n"
                 "  --exe [executable filename to debug]\n"
                 "  --gdb [GDB filename to use]\n"
+                "  --record [transcript filename or directory to write GDB traffic to]\n"
+                "  --replay [transcript filename to answer commands with instead of GDB]\n"
+                "  --bench-stops [count of --exe stops at bench_stop and steps to time, then exit]\n"
+                "  --bench-frames [count of headless frames to time per window, then exit]\n"
+                "  --bench-scale [multiplier for the --bench-frames source, locals, stack and console sizes]\n"
+                "  --trace [chrome trace json filename to write hot path timings to on exit]\n"
                 "  -h, --help see available flags to use\n";
             printf("%s", usage);
             return 1;
@@ -4447,8 +5250,47 @@ int main(int argc, char **argv)
             }
             else if (flag == "--exe")
             {
+                // checked after parsing, --replay can come later
                 gdb.debug_filename = argv[i++];
-                if (!VerifyFileExecutable(gdb.debug_filename.c_str()))
+            }
+            else if (flag == "--record")
+            {
+                if (!GDB_StartRecording(argv[i++]))
+                    return EXIT_FAILURE;
+            }
+            else if (flag == "--bench-stops")
+            {
+                int count = atoi(argv[i++]);
+                if (count <= 0)
+                    ExitMessagef("bad --bench-stops count %s\n", argv[i - 1]);
+                stop_bench.num_stops = (size_t)count;
+                stop_bench.requested = true;
+            }
+            else if (flag == "--bench-frames")
+            {
+                int count = atoi(argv[i++]);
+                if (count <= 0)
+                    ExitMessagef("bad --bench-frames count %s\n", argv[i - 1]);
+                frame_bench.num_frames = (size_t)count;
+                gui.headless = true;
+            }
+            else if (flag == "--bench-scale")
+            {
+                int scale = atoi(argv[i++]);
+                if (scale <= 0)
+                    ExitMessagef("bad --bench-scale %s\n", argv[i - 1]);
+                frame_bench.scale = (size_t)scale;
+            }
+            else if (flag == "--trace")
+            {
+                trace_filename = argv[i++];
+                TraceSetEnabled(true);
+                TraceSetCapture(true);
+            }
+            else if (flag == "--replay")
+            {
+                gdb.replay_filename = argv[i++];
+                if (!DoesFileExist(gdb.replay_filename.c_str()))
                     return EXIT_FAILURE;
             }
             else
@@ -4458,18 +5300,80 @@ int main(int argc, char **argv)
         }
     }
 
+    // a replayed session doesn't need the original executable
+    if (gdb.debug_filename != "" && gdb.replay_filename == "" &&
+        !VerifyFileExecutable(gdb.debug_filename.c_str()))
+        return EXIT_FAILURE;
+
+    if (gdb.replay_filename != "")
+    {
+        gdb.filename = gdb.replay_filename;
+    }
+    else if (frame_bench.num_frames != 0)
+    {
+        // scripted debug state instead of GDB, see SetupFrameBench
+        gdb.filename = "";
+    }
+
+    if (frame_bench.num_frames != 0)
+    {
+        // same layout and window size on every run
+        ini_data = "";
+    }
+
+    if (frame_bench.num_frames == 0 && stop_bench.num_stops == 0)
+    {
+        // all console output goes to a per-session log in the cache directory
+        String cache_path;
+        const char *xdg_cache_env = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (xdg_cache_env)
+            cache_path = xdg_cache_env;
+        else if (home)
+            cache_path = StringPrintf("%s/.cache", home);
+
+        if (cache_path != "")
+        {
+            mkdir(cache_path.c_str(), 0700);
+            cache_path += "/tug";
+            if ((0 == mkdir(cache_path.c_str(), 0777) || errno == EEXIST) &&
+                ConsoleOpenSpill(prog.log, cache_path.c_str()))
+            {
+                Printf("console log %s\n", prog.log.filename.c_str());
+            }
+        }
+    }
+
     if (gdb.filename != "" && 
         !GDB_StartProcess(gdb.filename, ""))
     {
         gdb.filename = "";
     }
 
+    if (stop_bench.num_stops != 0 && 
+        (gdb.spawned_pid == 0 || gdb.debug_filename == ""))
+    {
+        ExitMessage("--bench-stops needs GDB and an --exe to run\n");
+    }
+
     if (gdb.spawned_pid != 0 && gdb.debug_filename != "")
     {
         if (GDB_SetInferiorExe(gdb.debug_filename))
         {
+            if (stop_bench.num_stops != 0)
+            {
+                // show everything that gets queried on a stop
+                GDB_SendBlocking("-break-insert -f bench_stop");
+                gui.line_display = LineDisplay_Source_And_Disassembly;
+                prog.watch_vars.push_back( CreateVarObj("$pc") );
+                prog.watch_vars.push_back( CreateVarObj("$sp") );
+                stop_bench.sent_ns = GetNanoseconds();
+            }
+
             if (gdb.has_exec_run_start)
                 GDB_SendBlocking("-exec-run --start");
+            else if (stop_bench.num_stops != 0)
+                GDB_SendBlocking("-exec-run");
         }
         else
         {
@@ -4560,6 +5464,7 @@ int main(int argc, char **argv)
         gui.show_source     = LoadBool("Source", true);
         gui.show_registers  = LoadBool("Registers", false);
         gui.show_threads    = LoadBool("Threads", false);
+        gui.show_mi_traffic = LoadBool("MITraffic", false);
         gui.show_directory_viewer = LoadBool("DirectoryViewer", true);
 
         float font_size = LoadFloat("FontSize", DEFAULT_FONT_SIZE); 
@@ -4590,6 +5495,19 @@ int main(int argc, char **argv)
         }
         window_maximized = LoadBool("WindowMaximized", false);
         gui.hover_delay_ms = (int)LoadFloat("HoverDelay", 100);
+        gdb.command_timeout_ms = (int)LoadFloat("CommandTimeout", 5000);
+        float record_mb = LoadFloat("MaxRecordSize", 512);
+        float used_mb = (record_mb >= MAX_RECORD_SIZE_MIN_MB) ? record_mb : MAX_RECORD_SIZE_MIN_MB;
+        used_mb = (used_mb <= MAX_RECORD_SIZE_MAX_MB) ? used_mb : MAX_RECORD_SIZE_MAX_MB;
+        gdb.max_record_size = (size_t)used_mb * 1024 * 1024;
+        if (used_mb != record_mb)
+        {
+            PrintErrorf("MaxRecordSize %g out of range %d-%d, using %zu\n", record_mb,
+                        MAX_RECORD_SIZE_MIN_MB, MAX_RECORD_SIZE_MAX_MB, gdb.max_record_size / (1024 * 1024));
+        }
+        size_t resident_mb = (size_t)LoadFloat("ConsoleResidentMB", 64);
+        prog.log.max_resident_chunks = GetMax(resident_mb * 1024 * 1024 / CONSOLE_CHUNK_SIZE, 4);
+        prog.source_cache.max_bytes = (size_t)LoadFloat("SourceCacheMB", 256) * 1024 * 1024;
         cursor_blink = LoadBool("CursorBlink", true);
 
         // load debug session history
@@ -4615,21 +5533,38 @@ int main(int argc, char **argv)
         }
     }
 
+    if (frame_bench.num_frames != 0 && gdb.spawned_pid == 0)
+    {
+        if (frame_bench.scale == 0)
+            frame_bench.scale = 1;
+        SetupFrameBench();
+    }
+
     // initialize GLFW
     {
+        // null platform has windows without a display or a GL context
         glfwSetErrorCallback(glfw_error_callback);
+        if (gui.headless)
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
         gui.initialized_glfw = glfwInit();
         if (!gui.initialized_glfw)
             ExitMessage("glfwInit\n");
 
         glfwWindowHint(GLFW_MAXIMIZED, window_maximized);
+        if (gui.headless)
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
         gui.window = glfwCreateWindow(window_width, window_height,
                                       "Tug", NULL, NULL);
         if (gui.window == NULL)
             ExitMessage("glfwCreateWindow\n");
 
-        glfwMakeContextCurrent(gui.window);
-        glfwSwapInterval(1); // Enable vsync
+        if (!gui.headless)
+        {
+            glfwMakeContextCurrent(gui.window);
+            glfwSwapInterval(1); // Enable vsync
+        }
 
         if (!window_maximized && window_has_x_or_y)
         {
@@ -4648,6 +5583,7 @@ int main(int argc, char **argv)
 
         const auto OnDragDrop = [](GLFWwindow* /*window*/, int count, const char** paths)
         {
+            gui.this_frame.window_event = true;
             if (count == 1)
             {
                 const char *file = paths[0];
@@ -4658,6 +5594,19 @@ int main(int argc, char **argv)
             }
         };
         glfwSetDropCallback(gui.window, OnDragDrop);
+
+        // window changes that imgui doesn't queue as input
+        const auto OnRefresh = [](GLFWwindow* /*window*/)
+        {
+            gui.this_frame.window_event = true;
+        };
+        const auto OnResize = [](GLFWwindow* /*window*/, int /*width*/, int /*height*/)
+        {
+            gui.this_frame.window_event = true;
+        };
+        glfwSetWindowRefreshCallback(gui.window, OnRefresh);
+        glfwSetWindowSizeCallback(gui.window, OnResize);
+        can_wake_ui.store(true);
     }
 
     // Startup Dear ImGui
@@ -4668,13 +5617,24 @@ int main(int argc, char **argv)
     if (!gui.created_imgui_context)
         ExitMessage("ImGui::CreateContext\n");
 
-    gui.started_imgui_glfw = ImGui_ImplGlfw_InitForOpenGL(gui.window, true);
-    if (!gui.started_imgui_glfw)
-        ExitMessage("ImGui_ImplGlfw_InitForOpenGL\n");
+#if !defined(TUG_HEADLESS)
+    if (!gui.headless)
+    {
+        gui.started_imgui_glfw = ImGui_ImplGlfw_InitForOpenGL(gui.window, true);
+        if (!gui.started_imgui_glfw)
+            ExitMessage("ImGui_ImplGlfw_InitForOpenGL\n");
 
-    gui.started_imgui_opengl2 = ImGui_ImplOpenGL2_Init();
-    if (!gui.started_imgui_opengl2)
-        ExitMessage("ImGui_ImplOpenGL2_Init\n");
+        gui.started_imgui_opengl2 = ImGui_ImplOpenGL2_Init();
+        if (!gui.started_imgui_opengl2)
+            ExitMessage("ImGui_ImplOpenGL2_Init\n");
+    }
+    else
+#endif
+    {
+        gui.started_imgui_glfw = ImGui_ImplGlfw_InitForOther(gui.window, true);
+        if (!gui.started_imgui_glfw)
+            ExitMessage("ImGui_ImplGlfw_InitForOther\n");
+    }
 
     if (ini_data.size() != 0)
     {
@@ -4692,6 +5652,16 @@ int main(int argc, char **argv)
     SetWindowTheme(gui.window_theme);
     ImGui::GetStyle().ScrollbarSize = 20.0f;
 
+    // frames drawn after anything changes before sleeping again, imgui
+    // takes a few to settle hover state, popups and window sizes
+    const int BURST_FRAMES = 3;
+
+    // longest sleep, SIGINT and SIGTERM can't wake GLFW so this bounds 
+    // how long closing the window takes
+    const double MAX_WAIT_SECONDS = 0.25;
+    int burst_frames_left = BURST_FRAMES;
+    uint32_t drawn_num_wakes = num_ui_wakes.load();    // wakes already seen by the last drawn frame
+
     // Main loop
     while (!glfwWindowShouldClose(gui.window))
     {
@@ -4708,7 +5678,46 @@ int main(int argc, char **argv)
         }
 
         gui.this_frame = {};    // clear old frame data
-        glfwPollEvents();
+
+        // benchmarks and the null platform draw every frame, otherwise sleep until
+        // there is input, GDB or inferior output, or a RequestRedraw timer is due
+        bool draw_continuously = gui.headless || stop_bench.num_stops != 0;
+        if (draw_continuously || burst_frames_left > 0)
+        {
+            if (burst_frames_left > 0)
+                burst_frames_left--;
+            glfwPollEvents();
+        }
+        else
+        {
+            // a wake from while the last frame was drawing counts, its data
+            // may have come in after that frame took what was there
+            double wait = gui.redraw_time - glfwGetTime();
+            if (wait > 0.0 && drawn_num_wakes == num_ui_wakes.load())
+                glfwWaitEventsTimeout(GetMin(wait, MAX_WAIT_SECONDS));
+
+            pthread_mutex_lock(&inferior_output_lock);
+            bool has_inferior_output = (inferior_output.size() > 0);
+            pthread_mutex_unlock(&inferior_output_lock);
+
+            bool has_update = gui.redraw_time <= glfwGetTime() ||
+                              drawn_num_wakes != num_ui_wakes.load() ||
+                              RingCount(gdb.from_gdb) > 0 ||
+                              has_inferior_output ||
+                              ImGui::GetCurrentContext()->InputEventsQueue.Size > 0 ||
+                              gui.this_frame.window_event ||
+                              glfwWindowShouldClose(gui.window);
+            if (!has_update)
+                continue;
+
+            burst_frames_left = BURST_FRAMES;
+        }
+
+        // anything woken for after this point gets another frame
+        drawn_num_wakes = num_ui_wakes.load();
+
+        // timers get requested again by Draw while they are still needed
+        gui.redraw_time = DBL_MAX;
 
         if (gui.change_font)
         {
@@ -4716,7 +5725,10 @@ int main(int argc, char **argv)
             // TODO: reloading both fonts when source font changes, might change to font scaling instead
             gui.change_font = false;
             io.Fonts->Clear();
-            ImGui_ImplOpenGL2_DestroyFontsTexture();
+#if !defined(TUG_HEADLESS)
+            if (!gui.headless)
+                ImGui_ImplOpenGL2_DestroyFontsTexture();
+#endif
 
             const auto LoadFont = [&io](bool use_default_font, float font_size) -> ImFont *
             {
@@ -4764,38 +5776,75 @@ int main(int argc, char **argv)
             if (gui.default_font == NULL || gui.source_font == NULL)
                 break;
 
-            ImGui_ImplOpenGL2_CreateFontsTexture();
+            // no texture to upload to without a renderer
+            if (gui.headless)
+                io.Fonts->Build();
+#if !defined(TUG_HEADLESS)
+            else
+                ImGui_ImplOpenGL2_CreateFontsTexture();
+#endif
         }
 
         // Start the Dear ImGui frame
-        ImGui_ImplOpenGL2_NewFrame();
+#if !defined(TUG_HEADLESS)
+        if (!gui.headless)
+            ImGui_ImplOpenGL2_NewFrame();
+#endif
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), ImGuiDockNodeFlags_PassthruCentralNode);
         DrawDebugOverlay();
+        uint64_t draw_start_ns = GetNanoseconds();
         Draw();
+        uint64_t draw_ns = GetNanoseconds() - draw_start_ns;
+        if (IsTraceEnabled())
+        {
+            static const size_t draw_stat = TraceGetStat("Draw");
+            TraceRecord(draw_stat, draw_start_ns, draw_ns);
+        }
 
-        // Rendering
-        int display_w = 0, display_h = 0;
-        ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+        // held keys and buttons repeat, drag and scroll without new events,
+        // text input needs the cursor blink
+        if (ImGui::IsAnyMouseDown())
+            RequestRedraw();
+        for (const ImGuiKeyData &key : io.KeysData)
+            if (key.Down)
+                RequestRedraw();
+        if (io.WantTextInput && io.ConfigInputTextCursorBlink)
+            RequestRedraw(0.2);
 
         ImGui::Render();
-        glfwGetFramebufferSize(gui.window, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // If you are using this code with non-legacy OpenGL header/contexts (which you should not, prefer using imgui_impl_opengl3.cpp!!),
-        // you may need to backup/reset/restore other state, e.g. for current shader using the commented lines below.
-        //GLint last_program;
-        //glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-        //glUseProgram(0);
-        ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
-        //glUseProgram(last_program);
-
-        glfwMakeContextCurrent(gui.window);
-        glfwSwapBuffers(gui.window);
+
+#if !defined(TUG_HEADLESS)
+        if (!gui.headless)
+        {
+            // Rendering
+            int display_w = 0, display_h = 0;
+            ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+
+            glfwGetFramebufferSize(gui.window, &display_w, &display_h);
+            glViewport(0, 0, display_w, display_h);
+            glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // If you are using this code with non-legacy OpenGL header/contexts (which you should not, prefer using imgui_impl_opengl3.cpp!!),
+            // you may need to backup/reset/restore other state, e.g. for current shader using the commented lines below.
+            //GLint last_program;
+            //glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+            //glUseProgram(0);
+            ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+            //glUseProgram(last_program);
+
+            glfwMakeContextCurrent(gui.window);
+            glfwSwapBuffers(gui.window);
+        }
+#endif
+
+        if (stop_bench.num_stops != 0)
+            UpdateStopBench();
+        if (frame_bench.num_frames != 0)
+            UpdateFrameBench(draw_ns);
     }
 
     window_maximized = (0 != glfwGetWindowAttrib(gui.window, GLFW_MAXIMIZED));
@@ -4805,8 +5854,9 @@ int main(int argc, char **argv)
         glfwGetWindowSize(gui.window, &window_width, &window_height);
     }
 
-    // write config
-    FILE *f = fopen(ini_filename.c_str(), "wt");
+    // write config, benchmark runs leave it alone
+    bool is_bench = (stop_bench.requested || frame_bench.num_frames != 0);
+    FILE *f = (!is_bench) ? fopen(ini_filename.c_str(), "wt") : NULL;
     if (f != NULL)
     {
         // write custom tug ini information
@@ -4821,6 +5871,7 @@ int main(int argc, char **argv)
         fprintf(f, "Source=%d\n",   gui.show_source);
         fprintf(f, "Breakpoints=%d\n", gui.show_breakpoints);
         fprintf(f, "Threads=%d\n", gui.show_threads);
+        fprintf(f, "MITraffic=%d\n", gui.show_mi_traffic);
         fprintf(f, "DirectoryViewer=%d\n", gui.show_directory_viewer);
         fprintf(f, "FontFilename=%s\n", gui.font_filename.c_str());
         fprintf(f, "FontSize=%.0f\n", gui.font_size);
@@ -4835,6 +5886,10 @@ int main(int argc, char **argv)
         fprintf(f, "WindowY=%d\n", window_y);
         fprintf(f, "WindowMaximized=%d\n", window_maximized);
         fprintf(f, "HoverDelay=%d\n", gui.hover_delay_ms);
+        fprintf(f, "CommandTimeout=%d\n", gdb.command_timeout_ms);
+        fprintf(f, "MaxRecordSize=%zu\n", gdb.max_record_size / (1024 * 1024));
+        fprintf(f, "ConsoleResidentMB=%zu\n", prog.log.max_resident_chunks * CONSOLE_CHUNK_SIZE / (1024 * 1024));
+        fprintf(f, "SourceCacheMB=%zu\n", prog.source_cache.max_bytes / (1024 * 1024));
         fprintf(f, "CursorBlink=%d\n", io.ConfigInputTextCursorBlink);
 
         for (size_t i = 0; i < gui.session_history.size(); i++)
@@ -0,0 +1,282 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <string.h>
+#include <stdlib.h>
+
+// single producer/single consumer ring buffer
+//
+// cursors only ever increase and get masked on access, so the whole
+// capacity is usable and head - tail is always the element count.
+// the producer publishes head with release, the consumer publishes tail
+// with release, each side reads the other cursor with acquire.
+//
+// the wait lock is only taken by a side that is about to sleep, and by
+// the other side when it sees that someone is sleeping
+template <typename T>
+struct SPSCRing
+{
+    T *data;
+    size_t mask;                        // capacity - 1, capacity is a power of 2
+    std::atomic<size_t> head;           // next write index, owned by producer
+    std::atomic<size_t> tail;           // next read index, owned by consumer
+
+    std::atomic<int> num_waiting;
+    pthread_mutex_t wait_lock;
+    pthread_cond_t wait_cond;
+    bool initialized;
+};
+
+template <typename T>
+bool RingInit(SPSCRing<T> &ring, size_t capacity)
+{
+    // round up to a power of 2 for masking
+    size_t cap = 1;
+    while (cap < capacity)
+        cap <<= 1;
+
+    ring.data = (T *)calloc(cap, sizeof(T));
+    if (ring.data == NULL)
+        return false;
+
+    ring.mask = cap - 1;
+    ring.head.store(0);
+    ring.tail.store(0);
+    ring.num_waiting.store(0);
+    if (0 != pthread_mutex_init(&ring.wait_lock, NULL))
+    {
+        free(ring.data); ring.data = NULL;
+        return false;
+    }
+
+    if (0 != pthread_cond_init(&ring.wait_cond, NULL))
+    {
+        pthread_mutex_destroy(&ring.wait_lock);
+        free(ring.data); ring.data = NULL;
+        return false;
+    }
+
+    ring.initialized = true;
+    return true;
+}
+
+template <typename T>
+void RingFree(SPSCRing<T> &ring)
+{
+    if (ring.initialized)
+    {
+        pthread_cond_destroy(&ring.wait_cond);
+        pthread_mutex_destroy(&ring.wait_lock);
+        free(ring.data); ring.data = NULL;
+        ring.initialized = false;
+    }
+}
+
+template <typename T>
+inline size_t RingCapacity(const SPSCRing<T> &ring)
+{
+    return ring.mask + 1;
+}
+
+// number of elements ready to be read, exact for the consumer
+template <typename T>
+inline size_t RingCount(const SPSCRing<T> &ring)
+{
+    return ring.head.load(std::memory_order_acquire) -
+           ring.tail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+inline void RingWakeWaiters(SPSCRing<T> &ring)
+{
+    // pairs with the fence in RingWait, either the sleeper sees the new
+    // cursor or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring.num_waiting.load(std::memory_order_relaxed) > 0)
+    {
+        pthread_mutex_lock(&ring.wait_lock);
+        pthread_cond_broadcast(&ring.wait_cond);
+        pthread_mutex_unlock(&ring.wait_lock);
+    }
+}
+
+// block until there is data to read (want_data) or space to write,
+// timeout_ms < 0 waits forever. returns false on timeout
+template <typename T>
+inline bool RingWait(SPSCRing<T> &ring, bool want_data, int timeout_ms)
+{
+    const auto IsReady = [&]() -> bool
+    {
+        size_t count = RingCount(ring);
+        return (want_data) ? count > 0 : count < RingCapacity(ring);
+    };
+
+    if (IsReady())
+        return true;
+
+    timespec wait_for = {};
+    if (timeout_ms >= 0)
+    {
+        timeval now = {};
+        gettimeofday(&now, NULL);
+        long long nsec = (long long)now.tv_usec * 1000 + (long long)(timeout_ms % 1000) * 1000000;
+        wait_for.tv_sec = now.tv_sec + (timeout_ms / 1000) + (nsec / 1000000000);
+        wait_for.tv_nsec = nsec % 1000000000;
+    }
+
+    bool result = true;
+    pthread_mutex_lock(&ring.wait_lock);
+    ring.num_waiting.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (!IsReady())
+    {
+        int rc = (timeout_ms < 0)
+            ? pthread_cond_wait(&ring.wait_cond, &ring.wait_lock)
+            : pthread_cond_timedwait(&ring.wait_cond, &ring.wait_lock, &wait_for);
+        if (rc == ETIMEDOUT)
+        {
+            result = IsReady();
+            break;
+        }
+    }
+
+    ring.num_waiting.fetch_sub(1);
+    pthread_mutex_unlock(&ring.wait_lock);
+    return result;
+}
+
+template <typename T>
+inline bool RingWaitForData(SPSCRing<T> &ring, int timeout_ms)
+{
+    return RingWait(ring, true, timeout_ms);
+}
+
+template <typename T>
+inline bool RingWaitForSpace(SPSCRing<T> &ring, int timeout_ms)
+{
+    return RingWait(ring, false, timeout_ms);
+}
+
+//
+// producer
+//
+
+// contiguous writable region starting at head, stops at the buffer end
+// so the caller can read() straight into it
+template <typename T>
+size_t RingWriteSpan(SPSCRing<T> &ring, T **out)
+{
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    size_t tail = ring.tail.load(std::memory_order_acquire);
+    size_t free_count = RingCapacity(ring) - (head - tail);
+    size_t to_end = RingCapacity(ring) - (head & ring.mask);
+
+    *out = ring.data + (head & ring.mask);
+    return (free_count < to_end) ? free_count : to_end;
+}
+
+template <typename T>
+void RingCommitWrite(SPSCRing<T> &ring, size_t count)
+{
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    ring.head.store(head + count, std::memory_order_release);
+    RingWakeWaiters(ring);
+}
+
+// copy in up to count elements, returns the amount written
+template <typename T>
+size_t RingWrite(SPSCRing<T> &ring, const T *src, size_t count)
+{
+    size_t written = 0;
+    for (int pass = 0; pass < 2 && written < count; pass++)
+    {
+        // second pass picks up the wrapped region at the buffer start
+        T *dest = NULL;
+        size_t n = RingWriteSpan(ring, &dest);
+        if (n > count - written)
+            n = count - written;
+        if (n == 0)
+            break;
+
+        memcpy((void *)dest, (const void *)(src + written), n * sizeof(T));
+        ring.head.store(ring.head.load(std::memory_order_relaxed) + n,
+                        std::memory_order_release);
+        written += n;
+    }
+
+    if (written > 0)
+        RingWakeWaiters(ring);
+
+    return written;
+}
+
+//
+// consumer
+//
+
+// contiguous readable region starting at tail, stops at the buffer end
+template <typename T>
+size_t RingReadSpan(SPSCRing<T> &ring, T **out)
+{
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    size_t head = ring.head.load(std::memory_order_acquire);
+    size_t to_end = RingCapacity(ring) - (tail & ring.mask);
+
+    size_t count = head - tail;
+
+    *out = ring.data + (tail & ring.mask);
+    return (count < to_end) ? count : to_end;
+}
+
+template <typename T>
+void RingCommitRead(SPSCRing<T> &ring, size_t count)
+{
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    ring.tail.store(tail + count, std::memory_order_release);
+    RingWakeWaiters(ring);
+}
+
+// copy out up to count elements, returns the amount read
+template <typename T>
+size_t RingRead(SPSCRing<T> &ring, T *dest, size_t count)
+{
+    size_t num_read = 0;
+    for (int pass = 0; pass < 2 && num_read < count; pass++)
+    {
+        T *src = NULL;
+        size_t n = RingReadSpan(ring, &src);
+        if (n > count - num_read)
+            n = count - num_read;
+        if (n == 0)
+            break;
+
+        memcpy((void *)(dest + num_read), (const void *)src, n * sizeof(T));
+        ring.tail.store(ring.tail.load(std::memory_order_relaxed) + n,
+                        std::memory_order_release);
+        num_read += n;
+    }
+
+    if (num_read > 0)
+        RingWakeWaiters(ring);
+
+    return num_read;
+}
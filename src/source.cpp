@@ -0,0 +1,370 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// source files, no GUI dependencies so the benchmark can link this
+
+#include <sys/mman.h>
+#include <algorithm>
+#include "common.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// index of the next '\n' or '\r' at or after i, size when there are none
+static size_t FindLineEnding(const char *buf, size_t i, size_t size)
+{
+#if defined(__SSE2__)
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+
+    for (; i < size; i++)
+        if (buf[i] == '\n' || buf[i] == '\r')
+            break;
+
+    return i;
+}
+
+static void AddLineStart(File &file, size_t start)
+{
+    // the entry being replaced as the last one is now a complete line
+    size_t line_idx = file.lines.size() - 1;
+    size_t line_size = start - file.lines[line_idx];
+    if (file.longest_line_size < line_size)
+    {
+        file.longest_line_size = line_size;
+        file.longest_line_idx = line_idx;
+    }
+    file.lines.push_back(start);
+}
+
+bool IndexFileLines(File &file, size_t max_bytes)
+{
+    if (file.lines.size() == 0)
+        return false;
+
+    const char *data = GetFileData(file);
+    size_t size = GetFileSize(file);
+    size_t i = file.indexed_size;
+    size_t end = (max_bytes < size - i) ? i + max_bytes : size;
+
+    while (i < end)
+    {
+        i = FindLineEnding(data, i, end);
+        if (i == end)
+            break;
+
+        // \r\n is one ending, let the \n start the next line
+        bool is_crlf = (data[i] == '\r' && i + 1 < size && data[i + 1] == '\n');
+        i++;
+        if (!is_crlf)
+            AddLineStart(file, i);
+    }
+    file.indexed_size = end;
+
+    // a last line without an ending still needs its end marked
+    if (end == size && file.lines.back() != size)
+        AddLineStart(file, size);
+
+    return file.lines.back() != size;
+}
+
+bool IndexFileLinesTo(File &file, size_t line_idx)
+{
+    while (line_idx >= GetLineCount(file) &&
+           IndexFileLines(file, FILE_INDEX_STEP_SIZE))
+    {
+    }
+
+    return line_idx < GetLineCount(file);
+}
+
+StringView GetLine(const File &file, size_t line_idx)
+{
+    StringView result = {};
+    if (line_idx < GetLineCount(file))
+    {
+        const char *data = GetFileData(file);
+        size_t start = file.lines[line_idx];
+        size_t end = file.lines[line_idx + 1];
+
+        // strip the line ending here instead of compacting the file
+        if (end > start && data[end - 1] == '\n') end--;
+        if (end > start && data[end - 1] == '\r') end--;
+
+        result.data = data + start;
+        result.size = end - start;
+    }
+
+    return result;
+}
+
+static void ResetFileIndex(File &file)
+{
+    file.lines.clear();
+    file.lines.push_back(0);
+    file.indexed_size = 0;
+    file.longest_line_idx = 0;
+    file.longest_line_size = 0;
+}
+
+// mapped source files, so a SIGBUS from reading one that got truncated
+// on disk can be told apart from a real crash
+struct MappedRange
+{
+    const char *start;
+    size_t size;
+};
+static Vector<MappedRange> mapped_ranges;
+
+static void OnSourceBusError(int sig, siginfo_t *info, void *)
+{
+    // reads happen on the thread that maps and unmaps, the list is
+    // never halfway through a change when one of them faults
+    const char *addr = (const char *)info->si_addr;
+    for (const MappedRange &range : mapped_ranges)
+    {
+        if (addr >= range.start && addr < range.start + range.size)
+        {
+            // read zeros past the new end until IsFileStale loads it again
+            void *zeros = mmap((void *)range.start, range.size, PROT_READ, 
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+            if (zeros != MAP_FAILED)
+                return;
+            break;
+        }
+    }
+
+    // not a source file, crash like there was no handler
+    signal(sig, SIG_DFL);
+}
+
+static void AddMappedRange(const char *start, size_t size)
+{
+    static bool installed = false;
+    if (!installed)
+    {
+        struct sigaction act = {};
+        act.sa_sigaction = OnSourceBusError;
+        act.sa_flags = SA_SIGINFO;
+        if (0 > sigaction(SIGBUS, &act, NULL))
+            PrintErrorf("sigaction SIGBUS %s\n", GetErrorString(errno));
+        installed = true;
+    }
+
+    MappedRange add = { start, size };
+    mapped_ranges.push_back(add);
+}
+
+static void RemoveMappedRange(const char *start)
+{
+    for (size_t i = 0; i < mapped_ranges.size(); i++)
+    {
+        if (mapped_ranges[i].start == start)
+        {
+            mapped_ranges[i] = mapped_ranges.back();
+            mapped_ranges.pop_back();
+            break;
+        }
+    }
+}
+
+bool LoadFile(File &file)
+{
+    TRACE_SCOPE(trace, "LoadFile");
+    bool result = false;
+    struct stat sb = {};
+    if (file.lines.size() == 0 &&
+        0 == stat(file.filename.c_str(), &sb))
+    {
+        file.pinned = false;
+        int fd = open(file.filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            PrintErrorf("open %s\n", GetErrorString(errno));
+        }
+        else
+        {
+            size_t filesize = sb.st_size;
+            trace.bytes = filesize;
+            file.mtime = sb.st_mtime;
+            if (filesize > 0)
+            {
+                void *map = mmap(NULL, filesize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map != MAP_FAILED)
+                {
+                    file.map = (const char *)map;
+                    file.map_size = filesize;
+                    AddMappedRange(file.map, file.map_size);
+                }
+                else
+                {
+                    // not mappable, read it the old way
+                    file.buffer.resize(filesize);
+                    size_t total = 0;
+                    while (total < filesize)
+                    {
+                        ssize_t num_read = read(fd, &file.buffer[total], filesize - total);
+                        if (num_read < 0 && errno == EINTR)
+                            continue;
+                        if (num_read < 0)
+                            PrintErrorf("read %s\n", GetErrorString(errno));
+                        if (num_read <= 0)
+                            break;
+
+                        total += num_read;
+                    }
+                    file.buffer.resize(total);
+                }
+            }
+            close(fd); fd = -1;
+
+            // only the first screen is indexed here, the rest
+            // is done a step at a time while drawing
+            ResetFileIndex(file);
+            IndexFileLines(file, FILE_INDEX_FIRST_SIZE);
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+void UnloadFile(File &file)
+{
+    if (file.map != NULL)
+    {
+        RemoveMappedRange(file.map);
+        munmap((void *)file.map, file.map_size);
+    }
+
+    file.map = NULL;
+    file.map_size = 0;
+    file.buffer.clear();
+    file.buffer.shrink_to_fit();
+    file.lines.clear();
+    file.lines.shrink_to_fit();
+    file.indexed_size = 0;
+    file.longest_line_idx = 0;
+    file.longest_line_size = 0;
+
+    // the reloaded text can differ, measure it again on the next draw
+    file.metrics_font_size = 0;
+    file.metrics_longest_line_idx = BAD_INDEX;
+}
+
+bool IsFileStale(const File &file)
+{
+    // a mapped file that gets truncated underneath us would fault on read,
+    // reload anything that changed since it was mapped
+    struct stat sb = {};
+    return file.lines.size() != 0 &&
+           0 == stat(file.filename.c_str(), &sb) &&
+           (sb.st_mtime != file.mtime || (size_t)sb.st_size != GetFileSize(file));
+}
+
+void SetFileText(File &file, String text)
+{
+    UnloadFile(file);
+    file.pinned = true;
+    file.buffer = std::move(text);
+    ResetFileIndex(file);
+    IndexFileLines(file, SIZE_MAX);
+}
+
+static size_t GetFileResidentBytes(const File &file)
+{
+    if (file.lines.size() == 0 || file.pinned)
+        return 0;
+
+    return GetFileSize(file) + file.lines.capacity() * sizeof(file.lines[0]);
+}
+
+static void CountResidentBytes(SourceCache &cache, File &file)
+{
+    // only the difference since the last count, the line index
+    // keeps growing after the file gets loaded
+    size_t bytes = GetFileResidentBytes(file);
+    cache.resident_bytes += bytes - file.cache_bytes;
+    if (bytes != 0 && file.cache_bytes == 0) cache.num_resident++;
+    if (bytes == 0 && file.cache_bytes != 0) cache.num_resident--;
+    file.cache_bytes = bytes;
+}
+
+bool UseFile(SourceCache &cache, Vector<File> &files, size_t file_idx)
+{
+    File &file = files[file_idx];
+    if (IsFileStale(file))
+        UnloadFile(file);
+
+    bool result = true;
+    if (file.lines.size() != 0)
+    {
+        cache.hits++;
+    }
+    else
+    {
+        cache.misses++;
+        result = LoadFile(file);
+    }
+
+    file.last_used = ++cache.tick;
+    TrimSourceCache(cache, files, file_idx);
+    return result;
+}
+
+void TrimSourceCache(SourceCache &cache, Vector<File> &files, size_t keep_idx)
+{
+    // files only change size while they are the one being shown
+    if (keep_idx < files.size())
+        CountResidentBytes(cache, files[keep_idx]);
+
+    // the shown file alone can be over, there's nothing else to unload then
+    size_t keep_bytes = (keep_idx < files.size()) ? files[keep_idx].cache_bytes : 0;
+    if (cache.resident_bytes <= cache.max_bytes || cache.resident_bytes == keep_bytes)
+        return;
+
+    // anything loaded from disk can be loaded again, least recently used first
+    static Vector<size_t> lru;
+    lru.clear();
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        CountResidentBytes(cache, files[i]);
+        if (i != keep_idx && files[i].cache_bytes != 0)
+            lru.push_back(i);
+    }
+
+    std::sort(lru.begin(), lru.end(), [&files](size_t a, size_t b)
+    {
+        return files[a].last_used < files[b].last_used;
+    });
+
+    for (size_t i = 0; i < lru.size() && cache.resident_bytes > cache.max_bytes; i++)
+    {
+        File &file = files[ lru[i] ];
+        UnloadFile(file);
+        CountResidentBytes(cache, file);
+        cache.evictions++;
+    }
+}
@@ -0,0 +1,189 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include "common.h"
+
+// stop capturing instead of growing without bound, ~32MB of events
+#define TRACE_MAX_EVENTS (1024 * 1024)
+
+struct TraceEvent
+{
+    uint32_t stat_idx;
+    uint32_t thread_idx;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t bytes;
+};
+
+std::atomic<bool> trace_enabled;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceStat trace_stats[TRACE_MAX_STATS];
+static size_t trace_num_stats;
+static Vector<TraceEvent> trace_events;
+static bool trace_capture;
+static uint64_t trace_capture_start_ns;
+
+static std::atomic<uint32_t> trace_num_threads;
+
+static uint32_t GetTraceThreadIndex()
+{
+    // small stable ids instead of pthread_t for the tid field
+    static thread_local uint32_t thread_idx = trace_num_threads.fetch_add(1) + 1;
+    return thread_idx;
+}
+
+size_t TraceGetStat(const char *name, size_t namelen)
+{
+    size_t result = TRACE_STAT_INVALID;
+    namelen = GetMin(namelen, sizeof(trace_stats[0].name) - 1);
+
+    pthread_mutex_lock(&trace_lock);
+    for (size_t i = 0; i < trace_num_stats; i++)
+    {
+        if (0 == strncmp(trace_stats[i].name, name, namelen) &&
+            trace_stats[i].name[namelen] == '\0')
+        {
+            result = i;
+            break;
+        }
+    }
+
+    if (result == TRACE_STAT_INVALID && trace_num_stats < TRACE_MAX_STATS)
+    {
+        result = trace_num_stats++;
+        TraceStat &stat = trace_stats[result];
+        Zeroize(stat);
+        memcpy(stat.name, name, namelen);
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    return result;
+}
+
+size_t TraceGetStat(const char *name)
+{
+    return TraceGetStat(name, strlen(name));
+}
+
+void TraceRecord(size_t stat_idx, uint64_t start_ns, uint64_t duration_ns, uint64_t bytes)
+{
+    if (stat_idx >= TRACE_MAX_STATS)
+        return;
+
+    uint32_t thread_idx = GetTraceThreadIndex();
+
+    pthread_mutex_lock(&trace_lock);
+    TraceStat &stat = trace_stats[stat_idx];
+    stat.recent_ns[stat.count % TRACE_RECENT_COUNT] = duration_ns;
+    stat.count++;
+    stat.bytes += bytes;
+    stat.total_ns += duration_ns;
+
+    if (trace_capture && trace_events.size() < TRACE_MAX_EVENTS)
+    {
+        TraceEvent add = {};
+        add.stat_idx = (uint32_t)stat_idx;
+        add.thread_idx = thread_idx;
+        add.start_ns = start_ns;
+        add.duration_ns = duration_ns;
+        add.bytes = bytes;
+        trace_events.push_back(add);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void TraceSetEnabled(bool enabled)
+{
+    trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceSetCapture(bool capture)
+{
+    pthread_mutex_lock(&trace_lock);
+    if (capture && !trace_capture)
+    {
+        trace_events.clear();
+        trace_capture_start_ns = GetNanoseconds();
+    }
+    trace_capture = capture;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+bool TraceWriteChromeJson(const char *filename)
+{
+    FILE *f = fopen(filename, "wb");
+    if (f == NULL)
+    {
+        PrintErrorf("fopen trace file %s: %s\n", filename, GetErrorString(errno));
+        return false;
+    }
+
+    pthread_mutex_lock(&trace_lock);
+
+    // names only hold identifiers and MI commands, escape anything json cares about
+    Vector<String> names(trace_num_stats);
+    for (size_t i = 0; i < trace_num_stats; i++)
+    {
+        for (const char *c = trace_stats[i].name; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                names[i] += '\\';
+            if ((unsigned char)*c >= ' ')
+                names[i] += *c;
+        }
+    }
+
+    // chrome trace timestamps are microseconds
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < trace_events.size(); i++)
+    {
+        const TraceEvent &ev = trace_events[i];
+        uint64_t start_ns = (ev.start_ns > trace_capture_start_ns)
+                          ? ev.start_ns - trace_capture_start_ns : 0;
+        fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                   "\"pid\":1,\"tid\":%u,\"args\":{\"bytes\":%" PRIu64 "}}%s\n",
+                names[ev.stat_idx].c_str(), start_ns / 1000.0, ev.duration_ns / 1000.0,
+                ev.thread_idx, ev.bytes, (i + 1 < trace_events.size()) ? "," : "");
+    }
+    fprintf(f, "],\"displayTimeUnit\":\"ns\"}\n");
+
+    size_t num_events = trace_events.size();
+    pthread_mutex_unlock(&trace_lock);
+
+    bool result = (0 == ferror(f));
+    if (0 != fclose(f))
+        result = false;
+
+    if (result)
+        fprintf(stderr, "wrote %zu trace events to %s\n", num_events, filename);
+    else
+        PrintErrorf("writing trace file %s\n", filename);
+
+    return result;
+}
+
+void TraceGetStats(Vector<TraceStat> &out)
+{
+    pthread_mutex_lock(&trace_lock);
+    out.assign(trace_stats, trace_stats + trace_num_stats);
+    pthread_mutex_unlock(&trace_lock);
+
+    std::sort(out.begin(), out.end(), [](const TraceStat &a, const TraceStat &b)
+    {
+        return strcmp(a.name, b.name) < 0;
+    });
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2022 Kyle Sylvestre
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// scoped timers and counters for the hot paths
+//
+// stats are interned by name once per call site, a disabled scope is a
+// relaxed atomic load and a branch. enabled scopes take a lock on the way
+// out to update the stat and optionally append a chrome trace event
+
+#define TRACE_MAX_STATS 256
+#define TRACE_RECENT_COUNT 256      // samples kept for the rolling percentiles
+#define TRACE_STAT_INVALID (~(size_t)0)
+
+struct TraceStat
+{
+    char name[64];
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t total_ns;
+    uint64_t recent_ns[TRACE_RECENT_COUNT];     // ring, count % TRACE_RECENT_COUNT is next
+};
+
+extern std::atomic<bool> trace_enabled;
+
+inline bool IsTraceEnabled()
+{
+    return trace_enabled.load(std::memory_order_relaxed);
+}
+
+// index for name, TRACE_STAT_INVALID once the table is full
+size_t TraceGetStat(const char *name, size_t namelen);
+size_t TraceGetStat(const char *name);
+
+void TraceRecord(size_t stat_idx, uint64_t start_ns, uint64_t duration_ns, uint64_t bytes = 0);
+void TraceSetEnabled(bool enabled);
+void TraceSetCapture(bool capture);
+bool TraceWriteChromeJson(const char *filename);
+
+// copy of every stat for display, sorted by name
+void TraceGetStats(Vector<TraceStat> &out);
+
+struct TraceScope
+{
+    size_t stat_idx;
+    uint64_t start_ns;
+    uint64_t bytes;
+
+    TraceScope(size_t stat)
+    {
+        stat_idx = (IsTraceEnabled()) ? stat : TRACE_STAT_INVALID;
+        start_ns = (stat_idx != TRACE_STAT_INVALID) ? GetNanoseconds() : 0;
+        bytes = 0;
+    }
+
+    ~TraceScope()
+    {
+        if (stat_idx != TRACE_STAT_INVALID)
+            TraceRecord(stat_idx, start_ns, GetNanoseconds() - start_ns, bytes);
+    }
+};
+
+#define TRACE_SCOPE(var, name)\
+static const size_t var##_stat = TraceGetStat(name);\
+TraceScope var(var##_stat)
@@ -0,0 +1,136 @@
+// Copyright (C) 2022 Kyle Sylvestre
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// variable objects, no GUI dependencies so the benchmark can link this
+
+#include "common.h"
+#include "gdb.h"
+
+VarObj CreateVarObj(String name, String value)
+{
+    TRACE_SCOPE(trace, "CreateVarObj");
+    VarObj result = {};
+    result.name = name;
+    result.value = value;
+    result.changed = true;
+    
+    if (result.value == "") 
+    {
+        result.value = "???";
+    }
+
+    if (result.value[0] == '{')
+    {
+        value = name + " = " + value;
+        static struct ParseRecordContext ctx = {};
+
+        if (GDB_ParseEvaluation(value.c_str(), value.size(), ctx))
+        {
+            result.expr.atoms = ctx.atoms;
+            result.expr.buf = value;
+            GDB_UnescapeRecord(result.expr);
+            result.expr_changed.resize( ctx.atoms.size() );
+
+            //GDB_PrintRecordAtom(result.expr, result.expr.atoms[0], 0, out);
+        }
+    }
+
+    return result;
+}
+
+bool RecurseCheckChanged(VarObj &this_var, size_t this_parent_idx,
+                         const VarObj &last_var, size_t last_parent_idx)
+{
+    bool changed = false;
+    Assert((this_parent_idx < this_var.expr.atoms.size()) && 
+           (last_parent_idx < last_var.expr.atoms.size()));
+
+    RecordAtom &this_parent = this_var.expr.atoms[ this_parent_idx ];
+    const RecordAtom &last_parent = last_var.expr.atoms[ last_parent_idx ];
+    Assert( (this_parent.type == Atom_Struct || this_parent.type == Atom_Array) &&
+            (this_parent.type == last_parent.type) );
+
+    if (this_parent.value.length == last_parent.value.length)
+    {
+        size_t t_idx = this_parent.value.index;
+        size_t t_end = t_idx + this_parent.value.length;
+        size_t o_idx = last_parent.value.index;
+        size_t o_end = o_idx + last_parent.value.length;
+
+        for (; t_idx < t_end && o_idx < o_end; t_idx++, o_idx++)
+        {
+            const RecordAtom &this_child = this_var.expr.atoms[t_idx];
+            const RecordAtom &last_child = last_var.expr.atoms[o_idx];
+            if (this_child.type == Atom_Struct || this_child.type == Atom_Array)
+            {
+                changed |= RecurseCheckChanged(this_var, t_idx, 
+                                               last_var, o_idx);
+            }
+            else if (this_child.type == Atom_String)
+            {
+                // compare resolved text, the last one may have been drawn already
+                StringView this_text = GetAtomView(this_child, this_var.expr);
+                StringView last_text = GetAtomView(last_child, last_var.expr);
+
+                this_var.expr_changed[t_idx] 
+                    = (this_text.size != last_text.size) ||
+                    (0 != memcmp(this_text.data, last_text.data, this_text.size));
+
+                changed |= this_var.expr_changed[t_idx];
+            }
+            else
+            {
+                Assert(false);
+            }
+        }
+    }
+    else
+    {
+        // atom array/struct changed its length, set all to changed
+        changed = true;
+        size_t t_idx = this_parent.value.index;
+        size_t t_end = t_idx + this_parent.value.length;
+        for (size_t i = t_idx; i < t_end; i++)
+        {
+            this_var.expr_changed[i] = true;
+        }
+    }
+
+    this_var.expr_changed[this_parent_idx] = changed;
+    return changed;
+}
+
+void CheckIfChanged(VarObj &this_var, const VarObj &last_var)
+{
+    // timed here instead of per RecurseCheckChanged call so nested scopes don't double count
+    TRACE_SCOPE(trace, "RecurseCheckChanged");
+    bool this_agg = this_var.value[0] == '{';
+    bool last_agg = last_var.value[0] == '{';
+    if (this_agg && last_agg)
+    {
+        // aggregate, go through each child and check if it changed
+        this_var.changed = RecurseCheckChanged(this_var, 0, last_var, 0);
+    }
+    else if (!this_agg && !last_agg)
+    {
+        this_var.changed = (this_var.value != last_var.value);
+    }
+    else
+    {
+        this_var.changed = true;
+        for (size_t i = 0; i < this_var.expr_changed.size(); i++)
+            this_var.expr_changed[i] = true;
+    }
+}